@@ -0,0 +1,98 @@
+#include "alloc_counter.h"
+#include "profiler.h"
+#include "imgui.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+static thread_local uint64_t thread_allocations = 0;
+
+// Frames before the first reuse of every scratch buffer, shader and GL
+// object; allocations before this are expected
+const uint64_t kWarmupFrames = 120;
+
+static std::atomic<uint64_t> frames{0};
+static std::atomic<uint64_t> last_count{0};
+static std::atomic<uint64_t> max_count{0};          // after warm-up
+static std::atomic<uint64_t> allocating_frames{0};  // after warm-up
+static std::atomic<bool> fail_fast{false};
+}
+
+#ifdef SPOTLIGHT_COUNT_ALLOCATIONS
+void* operator new(std::size_t size) {
+    thread_allocations++;
+    if (size == 0) size = 1;
+    while (true) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+bool AllocationCountingEnabled() { return true; }
+#else
+bool AllocationCountingEnabled() { return false; }
+#endif
+
+uint64_t ThreadAllocationCount() {
+    return thread_allocations;
+}
+
+void RecordFrameAllocations(uint64_t count) {
+    last_count = count;
+    if (++frames <= kWarmupFrames || count == 0) return;
+    allocating_frames++;
+    if (count > max_count) max_count = count;
+    if (fail_fast) {
+        std::fprintf(stderr, "frame %llu made %llu heap allocations after warm-up\n",
+                     (unsigned long long)frames.load(), (unsigned long long)count);
+        std::abort();
+    }
+}
+
+void SetAllocationFailFast(bool enabled) {
+    fail_fast = enabled;
+}
+
+void RenderAllocationControls() {
+    PROFILE_ZONE("RenderAllocationControls");
+    ImGui::Begin("Allocations");
+    if (!AllocationCountingEnabled()) {
+        ImGui::TextWrapped("Not counted in this build. Configure with -DSPOTLIGHT_COUNT_ALLOCATIONS=ON.");
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("Render frames: %llu", (unsigned long long)frames.load());
+    ImGui::Text("Last frame: %llu", (unsigned long long)last_count.load());
+    ImGui::Text("After warm-up: %llu frames allocated, max %llu",
+                (unsigned long long)allocating_frames.load(), (unsigned long long)max_count.load());
+    bool abort_on_alloc = fail_fast;
+    if (ImGui::Checkbox("Abort on Allocation", &abort_on_alloc)) fail_fast = abort_on_alloc;
+    if (ImGui::Button("Reset")) {
+        allocating_frames = 0;
+        max_count = 0;
+    }
+    ImGui::End();
+}
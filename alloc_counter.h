@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// Global operator new calls made by the calling thread. Only counted in
+// builds configured with -DSPOTLIGHT_COUNT_ALLOCATIONS=ON; otherwise 0.
+uint64_t ThreadAllocationCount();
+bool AllocationCountingEnabled();
+
+// Render thread, once per frame with that frame's allocation count. With
+// fail-fast on, any allocation after the warm-up frames aborts the process
+// so the offending call stack shows up in the core dump or debugger.
+void RecordFrameAllocations(uint64_t count);
+void SetAllocationFailFast(bool enabled);
+
+void RenderAllocationControls();
@@ -9,6 +9,19 @@ const int closedPulse = 1000;
 const int openPulse = 1600;
 const int duration = 2000;
 
+// Must match kDefaultBaudRate in serial/serial_protocol.h
+const long baudRate = 1000000;
+
+// Binary framing, see serial/serial_protocol.h:
+// 0xA5 | len | seq | payload[len] | crc16 (CRC-16/CCITT-FALSE, little endian)
+const uint8_t frameSync = 0xA5;
+const uint8_t maxFramePayload = 32;
+
+bool binaryMode = false;  // set by the "~~" probe, cleared by reset
+int probeChars = 0;       // consecutive '~' seen in ASCII mode
+uint8_t frame[maxFramePayload + 4];  // len, seq, payload, crc
+int frameHave = -1;                  // -1 while hunting for sync
+
 struct GateState {
   Servo* servo;
   int startPulse = closedPulse;
@@ -23,7 +36,7 @@ GateState gates[3];
 String inputBuffer = "";
 
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(baudRate);
 
   gates[0].servo = &gate1;
   gates[1].servo = &gate2;
@@ -38,12 +51,93 @@ void setup() {
   }
 }
 
+uint16_t crc16(const uint8_t* data, int size) {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < size; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+void sendAck(uint8_t seq, uint8_t type) {
+  uint8_t out[7] = {frameSync, 2, seq, 'A', type, 0, 0};
+  uint16_t crc = crc16(out + 1, 4);
+  out[5] = crc & 0xFF;
+  out[6] = crc >> 8;
+  Serial.write(out, sizeof(out));
+}
+
+void handlePair(char action, char gateChar) {
+  if ((gateChar >= '1') && (gateChar <= '3')) {
+    int gateIndex = gateChar - '1';
+    GateState& g = gates[gateIndex];
+
+    if ((action == 'o' || action == 'O') && g.currentPulse != openPulse) {
+      g.startPulse = g.currentPulse;
+      g.endPulse = openPulse;
+      g.startTime = millis();
+      g.isMoving = true;
+    } else if ((action == 'c' || action == 'C') && g.currentPulse != closedPulse) {
+      g.startPulse = g.currentPulse;
+      g.endPulse = closedPulse;
+      g.startTime = millis();
+      g.isMoving = true;
+    }
+  }
+}
+
+void processFrame(uint8_t seq, const uint8_t* payload, uint8_t size) {
+  if (size >= 1 && payload[0] == 'D') {
+    for (int i = 1; i + 1 < size; i += 2) {
+      handlePair(payload[i], payload[i + 1]);
+    }
+    sendAck(seq, 'D');
+  } else if (size == 1 && payload[0] == 'H') {
+    sendAck(seq, 'H');
+  }
+}
+
+// Same state machine as FrameParser in serial/serial_protocol.cpp
+void feedFrame(uint8_t b) {
+  if (frameHave < 0) {
+    if (b == frameSync) frameHave = 0;
+    return;
+  }
+  if (frameHave == 0 && b > maxFramePayload) {
+    frameHave = (b == frameSync) ? 0 : -1;
+    return;
+  }
+  frame[frameHave++] = b;
+  int total = frame[0] + 4;
+  if (frameHave < total) return;
+
+  frameHave = -1;
+  uint16_t crc = crc16(frame, total - 2);
+  if ((crc & 0xFF) != frame[total - 2] || (crc >> 8) != frame[total - 1]) return;
+  processFrame(frame[1], frame + 2, frame[0]);
+}
+
 void loop() {
   // Read serial input into buffer
   while (Serial.available()) {
     char ch = Serial.read();
-    if (isAlpha(ch) || isDigit(ch)) {
-      inputBuffer += ch;
+    if (binaryMode) {
+      feedFrame((uint8_t)ch);
+    } else if (ch == '~') {
+      // "~~" from the host switches to binary frames
+      if (++probeChars == 2) {
+        binaryMode = true;
+        inputBuffer = "";
+        sendAck(0, 'H');
+      }
+    } else {
+      probeChars = 0;
+      if (isAlpha(ch) || isDigit(ch)) {
+        inputBuffer += ch;
+      }
     }
   }
 
@@ -52,23 +146,7 @@ void loop() {
     char action = inputBuffer.charAt(0);
     char gateChar = inputBuffer.charAt(1);
     inputBuffer = inputBuffer.substring(2); // Remove processed command
-
-    if ((gateChar >= '1') && (gateChar <= '3')) {
-      int gateIndex = gateChar - '1';
-      GateState& g = gates[gateIndex];
-
-      if ((action == 'o' || action == 'O') && g.currentPulse != openPulse) {
-        g.startPulse = g.currentPulse;
-        g.endPulse = openPulse;
-        g.startTime = millis();
-        g.isMoving = true;
-      } else if ((action == 'c' || action == 'C') && g.currentPulse != closedPulse) {
-        g.startPulse = g.currentPulse;
-        g.endPulse = closedPulse;
-        g.startTime = millis();
-        g.isMoving = true;
-      }
-    }
+    handlePair(action, gateChar);
   }
 
   // Animate each gate
@@ -11,8 +11,43 @@ StepperMotor motors[4] = {
   {12, 13}  // A-axis
 };
 
+// Must match kDefaultBaudRate in serial/serial_protocol.h. 1 Mbaud is exact
+// on a 16 MHz board.
+const long baudRate = 1000000;
+
+// Binary framing, see serial/serial_protocol.h:
+// 0xA5 | len | seq | payload[len] | crc16 (CRC-16/CCITT-FALSE, little endian)
+const uint8_t frameSync = 0xA5;
+const uint8_t maxFramePayload = 32;
+
+struct PumpCommand {
+  int motorIndex;
+  int dir;
+  unsigned long cycles;
+  unsigned long delayMicros;
+};
+
+// Commands parsed by serialEvent, started in order by loop()
+const uint8_t pendingSize = 8;
+PumpCommand pending[pendingSize];
+volatile uint8_t pendingHead = 0;
+volatile uint8_t pendingTail = 0;
+
+// The running dispense advances one step edge per loop() pass, so
+// serialEvent keeps reading and acking frames while the motor turns
+bool stepping = false;
+bool stepHigh = false;
+int stepMotor = 0;
+unsigned long stepsLeft = 0;
+unsigned long stepDelay = 0;
+unsigned long nextEdge = 0;
+
+bool binaryMode = false;  // set by the "~~" probe, cleared by reset
+uint8_t frame[maxFramePayload + 4];  // len, seq, payload, crc
+int frameHave = -1;                  // -1 while hunting for sync
+
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(baudRate);
   for (int i = 0; i < 4; i++) {
     pinMode(motors[i].dirPin, OUTPUT);
     pinMode(motors[i].stepPin, OUTPUT);
@@ -30,6 +65,54 @@ void loop() {
     inputString = "";
     stringComplete = false;
   }
+  if (!stepping && pendingTail != pendingHead) {
+    PumpCommand& c = pending[pendingTail];
+    startPump(c.motorIndex, c.dir, c.cycles, c.delayMicros);
+    pendingTail = (pendingTail + 1) % pendingSize;
+  }
+  if (stepping) stepPump();
+}
+
+int motorForPump(char pumpChar) {
+  if (pumpChar == 'x') return 0;
+  if (pumpChar == 'y') return 1;
+  if (pumpChar == 'z') return 2;
+  if (pumpChar == 'a') return 3;
+  return -1;
+}
+
+void startPump(int motorIndex, int dir, unsigned long cycles, unsigned long delayMicros) {
+  if (cycles == 0) return;
+  digitalWrite(motors[motorIndex].dirPin, dir);
+  stepping = true;
+  stepHigh = false;
+  stepMotor = motorIndex;
+  stepsLeft = cycles;
+  stepDelay = delayMicros;
+  nextEdge = micros();
+}
+
+void stepPump() {
+  unsigned long now = micros();
+  if ((long)(now - nextEdge) < 0) return;
+  stepHigh = !stepHigh;
+  digitalWrite(motors[stepMotor].stepPin, stepHigh ? HIGH : LOW);
+  if (!stepHigh && --stepsLeft == 0) stepping = false;
+  nextEdge += stepDelay;
+  // After a long serial burst, step on from now rather than catch up
+  if ((long)(now - nextEdge) > (long)stepDelay) nextEdge = now + stepDelay;
+}
+
+bool queuePump(int motorIndex, int dir, unsigned long cycles, unsigned long delayMicros) {
+  uint8_t next = (pendingHead + 1) % pendingSize;
+  if (next == pendingTail) return false;
+  PumpCommand& c = pending[pendingHead];
+  c.motorIndex = motorIndex;
+  c.dir = dir;
+  c.cycles = cycles;
+  c.delayMicros = delayMicros;
+  pendingHead = next;
+  return true;
 }
 
 void processCommand(String cmd) {
@@ -39,16 +122,10 @@ void processCommand(String cmd) {
   char dirChar = cmd.charAt(0);
   char pumpChar = cmd.charAt(1);
 
-  int motorIndex = -1;
-  if (pumpChar == 'x') motorIndex = 0;
-  else if (pumpChar == 'y') motorIndex = 1;
-  else if (pumpChar == 'z') motorIndex = 2;
-  else if (pumpChar == 'a') motorIndex = 3;
-
+  int motorIndex = motorForPump(pumpChar);
   if (motorIndex == -1) return;
 
   int dir = (dirChar == 'h') ? HIGH : LOW;
-  digitalWrite(motors[motorIndex].dirPin, dir);
 
   // Parse the two integers: cycles and delay in microseconds
   int firstSpace = cmd.indexOf(' ', 2);
@@ -56,22 +133,84 @@ void processCommand(String cmd) {
   int secondSpace = cmd.indexOf(' ', firstSpace + 1);
   if (secondSpace == -1) secondSpace = cmd.length();
 
-  int cycles = cmd.substring(firstSpace + 1, secondSpace).toInt();
-  int delayMicros = cmd.substring(secondSpace + 1).toInt();
+  long cycles = cmd.substring(firstSpace + 1, secondSpace).toInt();
+  long delayMicros = cmd.substring(secondSpace + 1).toInt();
+  if (cycles <= 0 || delayMicros < 0) return;
 
-  for (int i = 0; i < cycles; i++) {
-    digitalWrite(motors[motorIndex].stepPin, HIGH);
-    delayMicroseconds(delayMicros); 
-    digitalWrite(motors[motorIndex].stepPin, LOW);
-    delayMicroseconds(delayMicros); 
+  queuePump(motorIndex, dir, cycles, delayMicros);
+}
+
+uint16_t crc16(const uint8_t* data, int size) {
+  uint16_t crc = 0xFFFF;
+  for (int i = 0; i < size; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
   }
+  return crc;
+}
+
+void sendAck(uint8_t seq, uint8_t type) {
+  uint8_t out[7] = {frameSync, 2, seq, 'A', type, 0, 0};
+  uint16_t crc = crc16(out + 1, 4);
+  out[5] = crc & 0xFF;
+  out[6] = crc >> 8;
+  Serial.write(out, sizeof(out));
+}
+
+unsigned long readU32(const uint8_t* p) {
+  return (unsigned long)p[0] | ((unsigned long)p[1] << 8) |
+         ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+void processFrame(uint8_t seq, const uint8_t* payload, uint8_t size) {
+  if (size == 11 && payload[0] == 'P') {
+    int motorIndex = motorForPump(payload[1]);
+    if (motorIndex == -1) return;
+    int dir = (payload[2] == 'h') ? HIGH : LOW;
+    // Acked once queued; a full queue sends no ack and the host sees it lost
+    if (queuePump(motorIndex, dir, readU32(payload + 3), readU32(payload + 7))) sendAck(seq, 'P');
+  } else if (size == 1 && payload[0] == 'H') {
+    sendAck(seq, 'H');
+  }
+}
+
+// Same state machine as FrameParser in serial/serial_protocol.cpp
+void feedFrame(uint8_t b) {
+  if (frameHave < 0) {
+    if (b == frameSync) frameHave = 0;
+    return;
+  }
+  if (frameHave == 0 && b > maxFramePayload) {
+    frameHave = (b == frameSync) ? 0 : -1;
+    return;
+  }
+  frame[frameHave++] = b;
+  int total = frame[0] + 4;
+  if (frameHave < total) return;
+
+  frameHave = -1;
+  uint16_t crc = crc16(frame, total - 2);
+  if ((crc & 0xFF) != frame[total - 2] || (crc >> 8) != frame[total - 1]) return;
+  processFrame(frame[1], frame + 2, frame[0]);
 }
 
 // Serial input handling
 void serialEvent() {
   while (Serial.available()) {
     char inChar = (char)Serial.read();
-    if (inChar == '\n') {
+    if (binaryMode) {
+      feedFrame((uint8_t)inChar);
+    } else if (inChar == '\n') {
+      inputString.trim();
+      if (inputString == "~~") {
+        // Probe from the host: switch to binary frames
+        binaryMode = true;
+        inputString = "";
+        sendAck(0, 'H');
+        continue;
+      }
       stringComplete = true;
       Serial.println(inputString);
     } else {
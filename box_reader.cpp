@@ -0,0 +1,344 @@
+#include "box_reader.h"
+#include "profiler.h"
+#include "triple_buffer.h"
+#include "box_recording.h"
+#include "imgui.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <errno.h>
+#include <time.h>
+#include <sys/prctl.h>
+
+namespace {
+static std::thread reader_thread;
+static std::atomic<bool> running{false};
+static TripleBuffer<BoxFrame> latest_boxes;
+
+static std::atomic<int> wait_mode{1}; // 0 = busy spin, 1 = adaptive spin-then-park
+static std::atomic<int> spin_window_us{300};
+static std::atomic<int> max_park_us{2000};
+
+static std::atomic<uint64_t> frames{0};
+static std::atomic<uint64_t> wakeups{0};
+static std::atomic<uint64_t> empty_polls{0};
+static std::atomic<uint64_t> parks{0};
+static std::atomic<uint64_t> parked_us{0};
+static std::atomic<uint64_t> truncated{0};
+
+// Record/replay requests from the UI thread, applied by the reader thread
+enum StreamRequest { REQUEST_NONE, REQUEST_RECORD, REQUEST_STOP_RECORD, REQUEST_REPLAY, REQUEST_STOP_REPLAY };
+static std::mutex request_mutex;
+static std::atomic<bool> request_pending{false};
+static std::vector<StreamRequest> requests;
+static std::string request_record_path;
+static std::string request_replay_path;
+static float request_replay_speed = 1.0f;
+static bool request_replay_loop = false;
+
+static BoxRecorder recorder;
+static BoxReplay replay;
+static std::atomic<bool> recording{false};
+static std::atomic<bool> replaying{false};
+static std::atomic<uint64_t> frames_recorded{0};
+static std::atomic<uint64_t> frames_replayed{0};
+
+static uint64_t monotonic_us() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ull + ts.tv_nsec / 1000;
+}
+
+static void sleep_until_us(uint64_t deadline_us) {
+    timespec ts;
+    ts.tv_sec = deadline_us / 1000000ull;
+    ts.tv_nsec = (deadline_us % 1000000ull) * 1000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {}
+}
+
+static inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Frames arrive at the camera rate, so the reader sleeps until just before
+// the next expected frame and only spins inside a short window around it.
+// When a frame is overdue (tracker paused, rate unknown) it backs off
+// exponentially up to max_park_us.
+struct FrameWaiter {
+    uint64_t last_frame_us = 0;
+    uint64_t interval_us = 0;  // smoothed inter-frame interval
+    uint64_t backoff_us = 0;
+    int outliers = 0;
+    bool parked = false;
+
+    void on_frame(uint64_t now) {
+        if (last_frame_us != 0) {
+            uint64_t dt = now - last_frame_us;
+            if (interval_us != 0 && dt > 4 * interval_us && ++outliers < 4) {
+                // a gap in the stream, not a rate change; keep the estimate
+            } else {
+                interval_us = interval_us == 0 || outliers >= 4 ? dt : (interval_us * 7 + dt) / 8;
+                outliers = 0;
+            }
+        }
+        last_frame_us = now;
+        backoff_us = 0;
+        if (parked) wakeups++;
+        parked = false;
+    }
+
+    void on_empty(uint64_t now) {
+        parked = false;
+        const uint64_t spin = (uint64_t)spin_window_us.load(std::memory_order_relaxed);
+        const uint64_t max_park = (uint64_t)max_park_us.load(std::memory_order_relaxed);
+        const uint64_t expected = last_frame_us + interval_us;
+
+        uint64_t park_until = 0;
+        if (interval_us != 0 && now + spin < expected) {
+            park_until = std::min(expected - spin, now + max_park);
+        } else if (interval_us == 0 || now > expected + spin) {
+            backoff_us = backoff_us == 0 ? 20 : std::min(backoff_us * 2, max_park);
+            park_until = now + backoff_us;
+        }
+
+        if (park_until == 0) {
+            cpu_relax();
+            return;
+        }
+        parks++;
+        parked = true;
+        sleep_until_us(park_until);
+        parked_us += monotonic_us() - now;
+    }
+};
+
+static void post_request(StreamRequest request) {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    requests.push_back(request);
+    request_pending = true;
+}
+
+static void apply_requests() {
+    std::lock_guard<std::mutex> lock(request_mutex);
+    for (StreamRequest request : requests) {
+        switch (request) {
+        case REQUEST_RECORD:
+            recorder.open(request_record_path);
+            break;
+        case REQUEST_STOP_RECORD:
+            recorder.close();
+            break;
+        case REQUEST_REPLAY:
+            replay.open(request_replay_path, request_replay_speed, request_replay_loop);
+            break;
+        case REQUEST_STOP_REPLAY:
+            replay.close();
+            break;
+        default:
+            break;
+        }
+    }
+    requests.clear();
+    request_pending = false;
+    recording = recorder.is_open();
+    replaying = replay.is_open();
+}
+
+static bool pop_frame(shaman::SharedBoxQueue* queue, std::vector<shaman::Object>& out, uint64_t& writer_timestamp) {
+    if (replay.is_open()) {
+        bool got = replay.pop(out, writer_timestamp);
+        if (replay.finished()) {
+            std::cout << "box replay finished after " << replay.frames_played() << " frames" << std::endl;
+            replay.close();
+            replaying = false;
+        }
+        return got;
+    }
+    return queue->pop(out, writer_timestamp);
+}
+
+static void reader_loop(shaman::SharedBoxQueue* queue) {
+    // default 50us timer slack would dominate the wakeup latency
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+    SetProfilerThreadName("reader");
+
+    FrameWaiter waiter;
+    std::vector<shaman::Object> temp;
+    uint64_t writer_timestamp = 0;
+    while (running) {
+        if (request_pending) apply_requests();
+
+        // Drain what is ready, but hand back to apply_requests() when the UI
+        // posts one: a looping replay at speed 0 never runs dry
+        bool got_frame = false;
+        while (running && !request_pending) {
+            // Empty polls are not recorded; they would flush the ring in busy-spin mode
+            uint64_t pop_begin = ProfileNowNs();
+            if (!pop_frame(queue, temp, writer_timestamp)) break;
+            RecordProfileZone("reader pop", pop_begin, ProfileNowNs());
+
+            PROFILE_ZONE("box handoff");
+            BoxFrame& slot = latest_boxes.write_slot();
+            int count = (int)std::min(temp.size(), (size_t)kMaxFrameObjects);
+            if (count < (int)temp.size()) truncated++;
+            std::copy(temp.begin(), temp.begin() + count, slot.objects);
+            slot.count = count;
+            slot.writer_timestamp = writer_timestamp;
+            slot.received_us = get_time_us();
+            UpdateObjectTracks(slot.objects, count, writer_timestamp, slot.tracked);
+            slot.sequence = ++frames;
+            latest_boxes.publish();
+            got_frame = true;
+
+            if (recorder.is_open()) {
+                recorder.write_frame(temp.data(), (int)temp.size(), writer_timestamp);
+                frames_recorded = recorder.frames_written();
+            }
+            frames_replayed = replay.frames_played();
+        }
+
+        if (got_frame) {
+            waiter.on_frame(monotonic_us());
+            continue;
+        }
+        empty_polls++;
+        if (wait_mode == 0) {
+            cpu_relax();
+        } else {
+            waiter.on_empty(monotonic_us());
+        }
+    }
+}
+}
+
+void StartBoxReader(shaman::SharedBoxQueue& queue) {
+    if (running) return;
+    running = true;
+    reader_thread = std::thread(reader_loop, &queue);
+}
+
+void StopBoxReader() {
+    if (!running) return;
+    running = false;
+    reader_thread.join();
+    recorder.close();
+    replay.close();
+}
+
+void StartBoxRecording(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        request_record_path = path;
+    }
+    post_request(REQUEST_RECORD);
+}
+
+void StopBoxRecording() {
+    post_request(REQUEST_STOP_RECORD);
+}
+
+void StartBoxReplay(const std::string& path, float speed, bool loop) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex);
+        request_replay_path = path;
+        request_replay_speed = speed;
+        request_replay_loop = loop;
+    }
+    post_request(REQUEST_REPLAY);
+}
+
+void StopBoxReplay() {
+    post_request(REQUEST_STOP_REPLAY);
+}
+
+const BoxFrame& AcquireLatestBoxes() {
+    PROFILE_ZONE("AcquireLatestBoxes");
+    latest_boxes.update();
+    return latest_boxes.read_slot();
+}
+
+BoxReaderStats GetBoxReaderStats() {
+    BoxReaderStats s;
+    s.frames = frames;
+    s.wakeups = wakeups;
+    s.empty_polls = empty_polls;
+    s.parks = parks;
+    s.parked_us = parked_us;
+    s.truncated = truncated;
+    return s;
+}
+
+void RenderBoxReaderControls() {
+    PROFILE_ZONE("RenderBoxReaderControls");
+    static BoxReaderStats last = GetBoxReaderStats();
+    static BoxReaderStats rate = {0, 0, 0, 0, 0, 0};
+    static double last_time = glfwGetTime();
+
+    double now = glfwGetTime();
+    if (now - last_time >= 1.0) {
+        BoxReaderStats cur = GetBoxReaderStats();
+        double dt = now - last_time;
+        rate.frames = (uint64_t)((cur.frames - last.frames) / dt);
+        rate.wakeups = (uint64_t)((cur.wakeups - last.wakeups) / dt);
+        rate.empty_polls = (uint64_t)((cur.empty_polls - last.empty_polls) / dt);
+        rate.parks = (uint64_t)((cur.parks - last.parks) / dt);
+        rate.parked_us = (uint64_t)((cur.parked_us - last.parked_us) / dt);
+        last = cur;
+        last_time = now;
+    }
+
+    ImGui::Begin("Tracker Reader");
+    int mode = wait_mode;
+    ImGui::RadioButton("Busy Spin", &mode, 0); ImGui::SameLine();
+    ImGui::RadioButton("Spin then Park", &mode, 1);
+    wait_mode = mode;
+    if (mode == 1) {
+        int spin = spin_window_us;
+        int park = max_park_us;
+        ImGui::SliderInt("Spin Window (us)", &spin, 0, 2000);
+        ImGui::SliderInt("Max Park (us)", &park, 50, 10000);
+        spin_window_us = spin;
+        max_park_us = park;
+    }
+    ImGui::Separator();
+    ImGui::Text("Frames: %llu (%llu/s)", (unsigned long long)last.frames, (unsigned long long)rate.frames);
+    ImGui::Text("Wakeups: %llu (%llu/s)", (unsigned long long)last.wakeups, (unsigned long long)rate.wakeups);
+    ImGui::Text("Empty polls: %llu (%llu/s)", (unsigned long long)last.empty_polls, (unsigned long long)rate.empty_polls);
+    ImGui::Text("Parks: %llu (%llu/s)", (unsigned long long)last.parks, (unsigned long long)rate.parks);
+    ImGui::Text("Time parked: %.1f%%", rate.parked_us / 10000.0);
+
+    static char record_path[256] = "boxes.spbx";
+    static char replay_path[256] = "boxes.spbx";
+    static float replay_speed = 1.0f;
+    static bool replay_loop = false;
+    ImGui::Separator();
+    ImGui::InputText("Record File", record_path, sizeof(record_path));
+    if (recording) {
+        if (ImGui::Button("Stop Recording")) StopBoxRecording();
+        ImGui::SameLine();
+        ImGui::Text("%llu frames", (unsigned long long)frames_recorded.load());
+    } else if (ImGui::Button("Start Recording")) {
+        StartBoxRecording(record_path);
+    }
+    ImGui::InputText("Replay File", replay_path, sizeof(replay_path));
+    ImGui::SliderFloat("Replay Speed (0 = max)", &replay_speed, 0.0f, 16.0f, "%.1fx");
+    ImGui::Checkbox("Loop Replay", &replay_loop);
+    if (replaying) {
+        if (ImGui::Button("Stop Replay")) StopBoxReplay();
+        ImGui::SameLine();
+        ImGui::Text("%llu frames", (unsigned long long)frames_replayed.load());
+    } else if (ImGui::Button("Start Replay")) {
+        StartBoxReplay(replay_path, replay_speed, replay_loop);
+    }
+
+    if (last.truncated > 0) {
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "Truncated frames: %llu", (unsigned long long)last.truncated);
+    }
+    ImGui::End();
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include "shaman/shaman.h"
+#include "object_tracker.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Frames larger than this are truncated by the reader
+const int kMaxFrameObjects = 10240;
+
+// One tracker frame in a preallocated, fixed-capacity slot
+struct BoxFrame {
+    uint64_t writer_timestamp = 0;
+    uint64_t received_us = 0;  // get_time_us() when the reader popped it
+    uint64_t sequence = 0;
+    int count = 0;
+    shaman::Object objects[kMaxFrameObjects];
+    TrackedObject tracked[kMaxFrameObjects];  // track id and velocity per object
+
+    const shaman::Object* begin() const { return objects; }
+    const shaman::Object* end() const { return objects + count; }
+    size_t size() const { return (size_t)count; }
+};
+
+// Reader thread that drains the shaman box queue and keeps the newest frame.
+void StartBoxReader(shaman::SharedBoxQueue& queue);
+void StopBoxReader();
+
+// Newest complete frame. Render thread only; the reference stays valid
+// until the next call.
+const BoxFrame& AcquireLatestBoxes();
+
+// Record every popped frame, or replay a recording in place of the queue.
+// Requests are picked up by the reader thread on its next iteration.
+void StartBoxRecording(const std::string& path);
+void StopBoxRecording();
+void StartBoxReplay(const std::string& path, float speed, bool loop);
+void StopBoxReplay();
+
+void RenderBoxReaderControls();
+
+// Wait statistics, cumulative since StartBoxReader
+struct BoxReaderStats {
+    uint64_t frames;       // frames popped from the queue
+    uint64_t wakeups;      // parks that ended with a frame waiting
+    uint64_t empty_polls;  // pops that found the queue empty
+    uint64_t parks;        // times the reader went to sleep
+    uint64_t parked_us;    // total time spent asleep
+    uint64_t truncated;    // frames larger than kMaxFrameObjects
+};
+BoxReaderStats GetBoxReaderStats();
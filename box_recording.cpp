@@ -0,0 +1,193 @@
+#include "box_recording.h"
+#include <cstring>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <iostream>
+
+namespace {
+const char kMagic[4] = {'S', 'P', 'B', 'X'};
+const size_t kHeaderSize = 12;
+const size_t kFrameHeaderSize = 16;
+const uint32_t kObjectSize = sizeof(shaman::Object);
+
+const uint32_t kRectsOnlyVersion = 1;
+const size_t kRectsOnlyHeaderSize = 8;
+const size_t kRectsOnlyObjectSize = 4 * sizeof(float);
+
+// SharedBoxQueue hands objects across processes, so they are plain data
+static_assert(std::is_trivially_copyable<shaman::Object>::value, "objects are recorded as raw bytes");
+}
+
+BoxRecorder::BoxRecorder() : file_(nullptr), frames_(0) {}
+BoxRecorder::~BoxRecorder() { close(); }
+
+bool BoxRecorder::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) {
+        std::cerr << "failed to open box recording " << path << "\n";
+        return false;
+    }
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    std::fwrite(kMagic, 1, sizeof(kMagic), file_);
+    std::fwrite(&kBoxRecordingVersion, sizeof(kBoxRecordingVersion), 1, file_);
+    std::fwrite(&kObjectSize, sizeof(kObjectSize), 1, file_);
+    frames_ = 0;
+    return true;
+}
+
+void BoxRecorder::close() {
+    if (file_) {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool BoxRecorder::is_open() const {
+    return file_ != nullptr;
+}
+
+void BoxRecorder::write_frame(const shaman::Object* objects, int count, uint64_t writer_timestamp) {
+    if (!file_) return;
+    size_t size = kFrameHeaderSize + count * kObjectSize;
+    if (buffer_.size() < size) buffer_.resize(size);
+
+    char* p = buffer_.data();
+    uint32_t n = (uint32_t)count;
+    uint32_t reserved = 0;
+    std::memcpy(p, &writer_timestamp, 8);
+    std::memcpy(p + 8, &n, 4);
+    std::memcpy(p + 12, &reserved, 4);
+    if (count > 0) std::memcpy(p + kFrameHeaderSize, objects, count * kObjectSize);
+    std::fwrite(buffer_.data(), 1, size, file_);
+    frames_++;
+}
+
+BoxReplay::BoxReplay()
+    : data_(nullptr), size_(0), first_frame_(0), object_size_(0), rects_only_(false), offset_(0), speed_(1.0f),
+      loop_(false), finished_(false), frames_(0), stream_start_(0), wall_start_(0) {}
+BoxReplay::~BoxReplay() { close(); }
+
+bool BoxReplay::open(const std::string& path, float speed, bool loop) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "failed to open box recording " << path << "\n";
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < kRectsOnlyHeaderSize) {
+        std::cerr << "box recording " << path << " is empty\n";
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        std::cerr << "failed to map box recording " << path << "\n";
+        return false;
+    }
+
+    uint32_t version = 0;
+    uint32_t object_size = 0;
+    std::memcpy(&version, (const char*)map + 4, 4);
+    if ((size_t)st.st_size >= kHeaderSize) std::memcpy(&object_size, (const char*)map + 8, 4);
+    bool rects_only = version == kRectsOnlyVersion;
+    if (std::memcmp(map, kMagic, sizeof(kMagic)) != 0 || (!rects_only && version != kBoxRecordingVersion)) {
+        std::cerr << path << " is not a version " << kBoxRecordingVersion << " box recording\n";
+        munmap(map, st.st_size);
+        return false;
+    }
+    if (!rects_only && object_size != kObjectSize) {
+        std::cerr << path << " was recorded with " << object_size << "-byte objects, this build has "
+                  << kObjectSize << "\n";
+        munmap(map, st.st_size);
+        return false;
+    }
+    if (rects_only) std::cerr << path << " is a version 1 recording, replaying rects only\n";
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+    data_ = (const char*)map;
+    size_ = st.st_size;
+    rects_only_ = rects_only;
+    first_frame_ = rects_only ? kRectsOnlyHeaderSize : kHeaderSize;
+    object_size_ = rects_only ? kRectsOnlyObjectSize : kObjectSize;
+    offset_ = first_frame_;
+    speed_ = speed;
+    loop_ = loop;
+    finished_ = false;
+    frames_ = 0;
+    wall_start_ = 0;
+    return true;
+}
+
+void BoxReplay::close() {
+    if (data_) {
+        munmap((void*)data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+bool BoxReplay::is_open() const {
+    return data_ != nullptr;
+}
+
+const char* BoxReplay::read_frame_header(size_t offset, uint64_t& timestamp, uint32_t& count) const {
+    if (offset + kFrameHeaderSize > size_) return nullptr;
+    std::memcpy(&timestamp, data_ + offset, 8);
+    std::memcpy(&count, data_ + offset + 8, 4);
+    // a truncated last frame (recorder killed mid-write) ends the stream
+    if (offset + kFrameHeaderSize + (size_t)count * object_size_ > size_) return nullptr;
+    return data_ + offset + kFrameHeaderSize;
+}
+
+bool BoxReplay::pop(std::vector<shaman::Object>& out, uint64_t& writer_timestamp) {
+    if (!data_ || finished_) return false;
+
+    uint64_t timestamp;
+    uint32_t count;
+    const char* objects = read_frame_header(offset_, timestamp, count);
+    if (!objects && loop_ && frames_ > 0) {
+        offset_ = first_frame_;
+        wall_start_ = 0;
+        objects = read_frame_header(offset_, timestamp, count);
+    }
+    if (!objects) {
+        finished_ = true;
+        return false;
+    }
+
+    uint64_t now = get_time_us();
+    if (wall_start_ == 0) {
+        wall_start_ = now;
+        stream_start_ = timestamp;
+    }
+    uint64_t due = now;
+    if (speed_ > 0.0f && timestamp > stream_start_) {
+        due = wall_start_ + (uint64_t)((timestamp - stream_start_) / speed_);
+    }
+    if (due > now) return false;
+
+    out.resize(count);
+    if (!rects_only_) {
+        if (count > 0) std::memcpy(out.data(), objects, (size_t)count * kObjectSize);
+    } else {
+        for (uint32_t i = 0; i < count; ++i) {
+            float rect[4];
+            std::memcpy(rect, objects + i * kRectsOnlyObjectSize, kRectsOnlyObjectSize);
+            out[i] = shaman::Object();
+            out[i].rect.x = rect[0];
+            out[i].rect.y = rect[1];
+            out[i].rect.width = rect[2];
+            out[i].rect.height = rect[3];
+        }
+    }
+    writer_timestamp = due;
+    offset_ += kFrameHeaderSize + (size_t)count * object_size_;
+    frames_++;
+    return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "shaman/shaman.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// On-disk layout, little endian, append only:
+//   header  "SPBX" | uint32 version | uint32 object_size
+//   frame   uint64 writer_timestamp | uint32 count | uint32 reserved
+//           count x shaman::Object, object_size bytes each, as in memory
+// Objects are stored whole, so a replay carries every field the live
+// reader sees. Recordings only replay in builds with the same
+// shaman::Object layout; object_size catches most mismatches. Version 1
+// recordings stored rects only ({ float x, y, width, height }, no
+// object_size) and replay with the other fields zeroed.
+const uint32_t kBoxRecordingVersion = 2;
+
+class BoxRecorder {
+public:
+    BoxRecorder();
+    ~BoxRecorder();
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    void write_frame(const shaman::Object* objects, int count, uint64_t writer_timestamp);
+    uint64_t frames_written() const { return frames_; }
+
+private:
+    FILE* file_;
+    uint64_t frames_;
+    std::vector<char> buffer_;
+};
+
+// Memory-mapped recording that stands in for shaman::SharedBoxQueue.
+// speed is a multiple of real time; 0 replays as fast as possible.
+class BoxReplay {
+public:
+    BoxReplay();
+    ~BoxReplay();
+
+    bool open(const std::string& path, float speed, bool loop);
+    void close();
+    bool is_open() const;
+
+    // Same contract as SharedBoxQueue::pop. Timestamps are rebased onto
+    // get_time_us() so latency accounting stays meaningful.
+    bool pop(std::vector<shaman::Object>& out, uint64_t& writer_timestamp);
+
+    uint64_t frames_played() const { return frames_; }
+    bool finished() const { return finished_; }
+
+private:
+    const char* read_frame_header(size_t offset, uint64_t& timestamp, uint32_t& count) const;
+
+    const char* data_;
+    size_t size_;
+    size_t first_frame_;  // offset past the file header
+    size_t object_size_;  // bytes per recorded object
+    bool rects_only_;     // version 1
+    size_t offset_;
+    float speed_;
+    bool loop_;
+    bool finished_;
+    uint64_t frames_;
+    uint64_t stream_start_;
+    uint64_t wall_start_;
+};
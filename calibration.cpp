@@ -0,0 +1,331 @@
+#include "calibration.h"
+#include "profiler.h"
+#include "box_reader.h"
+#include "triple_buffer.h"
+#include "imgui.h"
+#include "json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+const char* kCalibrationDir = "/home/user/orange_data/config/calibration";
+
+// What the tracker sees while the dots are shown
+struct CalibrationProbe {
+    int objects = 0;
+    float camera_x = 0.0f, camera_y = 0.0f;  // the object's center when exactly one is tracked
+    int width = 0, height = 0;                // spotlight window it was drawn in
+};
+static TripleBuffer<CalibrationProbe> probe;
+
+// UI thread
+static bool use_homography = false;
+static bool fitted = false;
+static float homography[9];
+static int fit_width = 0, fit_height = 0;
+static float fit_rms_px = 0.0f;
+static bool captured[kCalibrationDots] = {false, false, false, false};
+static float camera_points[2 * kCalibrationDots];
+static float screen_points[2 * kCalibrationDots];
+static int selected_dot = 0;
+static std::string status;
+
+static std::string rig_calibration_path() {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    return std::string(kCalibrationDir) + "/" + host + ".json";
+}
+
+// Similarity taking the points to zero mean and mean distance sqrt(2)
+static void normalization(const float* xy, int n, double t[9]) {
+    double cx = 0.0, cy = 0.0;
+    for (int i = 0; i < n; ++i) {
+        cx += xy[2 * i];
+        cy += xy[2 * i + 1];
+    }
+    cx /= n;
+    cy /= n;
+    double d = 0.0;
+    for (int i = 0; i < n; ++i) {
+        d += std::hypot(xy[2 * i] - cx, xy[2 * i + 1] - cy);
+    }
+    d /= n;
+    double s = d > 0.0 ? std::sqrt(2.0) / d : 1.0;
+    double m[9] = { s, 0.0, -s * cx, 0.0, s, -s * cy, 0.0, 0.0, 1.0 };
+    std::copy(m, m + 9, t);
+}
+
+static void multiply(const double a[9], const double b[9], double out[9]) {
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            out[3 * r + c] = a[3 * r] * b[c] + a[3 * r + 1] * b[3 + c] + a[3 * r + 2] * b[6 + c];
+        }
+    }
+}
+
+// Gaussian elimination with partial pivoting on an 8x8 system augmented with its right-hand side
+static bool solve8(double a[8][9], double x[8]) {
+    for (int col = 0; col < 8; ++col) {
+        int pivot = col;
+        for (int r = col + 1; r < 8; ++r) {
+            if (std::fabs(a[r][col]) > std::fabs(a[pivot][col])) pivot = r;
+        }
+        if (std::fabs(a[pivot][col]) < 1e-10) return false;
+        if (pivot != col) {
+            for (int c = 0; c < 9; ++c) std::swap(a[col][c], a[pivot][c]);
+        }
+        for (int r = col + 1; r < 8; ++r) {
+            double f = a[r][col] / a[col][col];
+            for (int c = col; c < 9; ++c) a[r][c] -= f * a[col][c];
+        }
+    }
+    for (int r = 7; r >= 0; --r) {
+        double sum = a[r][8];
+        for (int c = r + 1; c < 8; ++c) sum -= a[r][c] * x[c];
+        x[r] = sum / a[r][r];
+    }
+    return true;
+}
+
+static void project(const float h[9], float x, float y, float& sx, float& sy) {
+    float w = h[6] * x + h[7] * y + h[8];
+    sx = (h[0] * x + h[1] * y + h[2]) / w;
+    sy = (h[3] * x + h[4] * y + h[5]) / w;
+}
+
+static void fit_captured() {
+    fitted = FitHomography(camera_points, screen_points, kCalibrationDots, homography);
+    if (!fitted) {
+        status = "Fit failed: three or more dots are collinear";
+        use_homography = false;
+        return;
+    }
+    double sum = 0.0;
+    for (int i = 0; i < kCalibrationDots; ++i) {
+        float sx, sy;
+        project(homography, camera_points[2 * i], camera_points[2 * i + 1], sx, sy);
+        sum += std::pow(sx - screen_points[2 * i], 2) + std::pow(sy - screen_points[2 * i + 1], 2);
+    }
+    fit_rms_px = (float)std::sqrt(sum / kCalibrationDots);
+    use_homography = true;
+    status = "Fitted; save to keep it for this rig";
+}
+
+static void capture(int dot, const CalibrationProbe& p) {
+    camera_points[2 * dot] = p.camera_x;
+    camera_points[2 * dot + 1] = p.camera_y;
+    CalibrationDotPosition(dot, p.width, p.height, screen_points[2 * dot], screen_points[2 * dot + 1]);
+    captured[dot] = true;
+    fit_width = p.width;
+    fit_height = p.height;
+
+    for (int i = 1; i <= kCalibrationDots; ++i) {
+        int next = (dot + i) % kCalibrationDots;
+        if (!captured[next]) {
+            selected_dot = next;
+            return;
+        }
+    }
+    fit_captured();
+}
+}
+
+void CalibrationDotPosition(int dot, int width, int height, float& x, float& y) {
+    x = width / 2.0f + (dot % 2 == 0 ? -height / 2.0f : height / 2.0f);
+    y = dot < 2 ? 0.0f : (float)height;
+}
+
+bool FitHomography(const float* camera_xy, const float* screen_xy, int n, float h[9]) {
+    if (n < 4) return false;
+    double tc[9], ts[9];
+    normalization(camera_xy, n, tc);
+    normalization(screen_xy, n, ts);
+
+    // Normal equations for the eight unknowns with h[8] fixed at 1:
+    //   u = (h0 x + h1 y + h2) / (h6 x + h7 y + 1), likewise v
+    double a[8][9] = {};
+    for (int i = 0; i < n; ++i) {
+        double x = tc[0] * camera_xy[2 * i] + tc[2];
+        double y = tc[4] * camera_xy[2 * i + 1] + tc[5];
+        double u = ts[0] * screen_xy[2 * i] + ts[2];
+        double v = ts[4] * screen_xy[2 * i + 1] + ts[5];
+        double rows[2][9] = {
+            { x, y, 1.0, 0.0, 0.0, 0.0, -u * x, -u * y, u },
+            { 0.0, 0.0, 0.0, x, y, 1.0, -v * x, -v * y, v },
+        };
+        for (const double* row : rows) {
+            for (int r = 0; r < 8; ++r) {
+                for (int c = 0; c < 9; ++c) a[r][c] += row[r] * row[c];
+            }
+        }
+    }
+    double hn[9];
+    if (!solve8(a, hn)) return false;
+    hn[8] = 1.0;
+
+    // Undo the normalisation: H = ts^-1 * Hn * tc
+    const double s = ts[0];
+    double ts_inv[9] = { 1.0 / s, 0.0, -ts[2] / s, 0.0, 1.0 / s, -ts[5] / s, 0.0, 0.0, 1.0 };
+    double tmp[9], out[9];
+    multiply(hn, tc, tmp);
+    multiply(ts_inv, tmp, out);
+    if (std::fabs(out[8]) < 1e-12) return false;
+    for (int i = 0; i < 9; ++i) h[i] = (float)(out[i] / out[8]);
+    return true;
+}
+
+CalibrationTransform HomographyTransform(const HomographyCalibration& calibration, int width, int height) {
+    const float sx = calibration.width > 0 ? (float)width / calibration.width : 1.0f;
+    const float sy = calibration.height > 0 ? (float)height / calibration.height : 1.0f;
+    const float* h = calibration.h;
+    CalibrationTransform t = {{ h[0] * sx, h[1] * sx, h[2] * sx,
+                                h[3] * sy, h[4] * sy, h[5] * sy,
+                                h[6], h[7], h[8] }};
+    return t;
+}
+
+void PublishCalibrationProbe(const BoxFrame& frame, int width, int height) {
+    CalibrationProbe& p = probe.write_slot();
+    p.objects = frame.count;
+    if (frame.count == 1) {
+        p.camera_x = frame.tracked[0].x;
+        p.camera_y = frame.tracked[0].y;
+    }
+    p.width = width;
+    p.height = height;
+    probe.publish();
+}
+
+bool LoadRigCalibration() {
+    const std::string path = rig_calibration_path();
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        status = "No calibration saved for this rig";
+        return false;
+    }
+    try {
+        json j;
+        in >> j;
+        for (int i = 0; i < 9; ++i) homography[i] = j.at("homography").at(i).get<float>();
+        fit_width = j.at("width").get<int>();
+        fit_height = j.at("height").get<int>();
+        for (int i = 0; i < kCalibrationDots; ++i) {
+            camera_points[2 * i] = j.at("camera_points").at(i).at(0).get<float>();
+            camera_points[2 * i + 1] = j.at("camera_points").at(i).at(1).get<float>();
+            screen_points[2 * i] = j.at("screen_points").at(i).at(0).get<float>();
+            screen_points[2 * i + 1] = j.at("screen_points").at(i).at(1).get<float>();
+            captured[i] = true;
+        }
+        fit_rms_px = j.value("rms_px", 0.0f);
+        use_homography = j.value("enabled", true);
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing calibration " << path << ": " << e.what() << "\n";
+        status = "Failed to parse " + path;
+        fitted = false;
+        use_homography = false;
+        return false;
+    }
+    fitted = true;
+    status = "Loaded " + path;
+    return true;
+}
+
+bool SaveRigCalibration() {
+    if (!fitted) return false;
+    if (mkdir(kCalibrationDir, 0755) != 0 && errno != EEXIST) {
+        std::perror("failed to create calibration directory");
+    }
+    json j;
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    j["hostname"] = host;
+    j["enabled"] = use_homography;
+    j["width"] = fit_width;
+    j["height"] = fit_height;
+    j["rms_px"] = fit_rms_px;
+    j["homography"] = std::vector<float>(homography, homography + 9);
+    for (int i = 0; i < kCalibrationDots; ++i) {
+        j["camera_points"].push_back({ camera_points[2 * i], camera_points[2 * i + 1] });
+        j["screen_points"].push_back({ screen_points[2 * i], screen_points[2 * i + 1] });
+    }
+
+    const std::string path = rig_calibration_path();
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::perror("failed to write rig calibration");
+        status = "Failed to write " + path;
+        return false;
+    }
+    out << j.dump(4) << "\n";
+    status = "Saved " + path;
+    return true;
+}
+
+HomographyCalibration GetHomographyCalibration() {
+    HomographyCalibration c;
+    c.enabled = fitted && use_homography;
+    std::copy(homography, homography + 9, c.h);
+    c.width = fit_width;
+    c.height = fit_height;
+    return c;
+}
+
+int GetCalibrationDot() {
+    return selected_dot;
+}
+
+void RenderHomographyControls(bool calibrating) {
+    PROFILE_ZONE("RenderHomographyControls");
+    probe.update();
+    const CalibrationProbe& p = probe.read_slot();
+
+    ImGui::Text("Homography (corner dots)");
+    if (calibrating) {
+        ImGui::Text("Tracked objects: %d", p.objects);
+        if (p.objects != 1) {
+            ImGui::TextColored(ImVec4(1, 1, 0, 1), "Hold exactly one object on the green dot");
+        }
+    } else {
+        ImGui::Text("Enable Calibration Mode to capture dots");
+    }
+    static const char* dot_names[kCalibrationDots] = { "Top Left", "Top Right", "Bottom Left", "Bottom Right" };
+    for (int i = 0; i < kCalibrationDots; ++i) {
+        ImGui::RadioButton(dot_names[i], &selected_dot, i);
+        ImGui::SameLine();
+        if (captured[i]) {
+            ImGui::Text("camera (%.1f, %.1f)", camera_points[2 * i], camera_points[2 * i + 1]);
+        } else {
+            ImGui::Text("-");
+        }
+    }
+    if (ImGui::Button("Capture Dot") && calibrating && p.objects == 1) {
+        capture(selected_dot, p);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Dots")) {
+        for (int i = 0; i < kCalibrationDots; ++i) captured[i] = false;
+        selected_dot = 0;
+        fitted = false;
+        use_homography = false;
+        status.clear();
+    }
+    if (fitted) {
+        ImGui::Checkbox("Use Homography", &use_homography);
+        ImGui::SameLine();
+        ImGui::Text("fit error %.2f px", fit_rms_px);
+    }
+    if (ImGui::Button("Save Rig Calibration")) SaveRigCalibration();
+    ImGui::SameLine();
+    if (ImGui::Button("Reload")) LoadRigCalibration();
+    if (!status.empty()) ImGui::Text("%s", status.c_str());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "projection.h"
+
+struct BoxFrame;
+
+const int kCalibrationDots = 4;
+
+// Camera-to-window homography fitted on this rig, for a window of width x height
+struct HomographyCalibration {
+    bool enabled;  // fitted and switched on; otherwise the offset/scale sliders apply
+    float h[9];
+    int width, height;
+};
+
+// Window position of calibration dot 0..3: the corners of the centered square
+void CalibrationDotPosition(int dot, int width, int height, float& x, float& y);
+
+// Least-squares DLT fit of screen = H * camera to n >= 4 point pairs, with
+// Hartley normalisation. Returns false if the points are degenerate
+// (fewer than four, or three of them collinear).
+bool FitHomography(const float* camera_xy, const float* screen_xy, int n, float h[9]);
+
+// The fitted homography, rescaled for a window of a different size
+CalibrationTransform HomographyTransform(const HomographyCalibration& calibration, int width, int height);
+
+// Render thread, while calibrating: reports where the tracker sees the
+// single object being held on a dot
+void PublishCalibrationProbe(const BoxFrame& frame, int width, int height);
+
+// Per-rig calibration file, /home/user/orange_data/config/calibration/<hostname>.json
+bool LoadRigCalibration();
+bool SaveRigCalibration();
+
+HomographyCalibration GetHomographyCalibration();
+int GetCalibrationDot();  // dot selected for the next capture
+
+// Capture and fit controls; drawn inside the Spotlight panel
+void RenderHomographyControls(bool calibrating);
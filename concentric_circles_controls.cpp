@@ -1,9 +1,9 @@
 #include "concentric_circles_controls.h"
+#include "profiler.h"
+#include "gl_shader.h"
 #include <imgui.h>
-#include <GLFW/glfw3.h>
 #include <cmath>
 #include <algorithm>
-#include <deque>
 
 static bool rings_enabled = false;
 static ImVec2 center = ImVec2(0.5f, 0.5f); 
@@ -14,90 +14,186 @@ static float ring_gap = 0.02f;
 static ImVec4 ring_color = ImVec4(1,1,1,1);
 static float thickness = 0.01f;
 static float shrink_speed = 80.0f;
+static int expanding = 0;
 
+static uint32_t reset_count = 0;
 
-typedef struct {
-    float radius; 
-} RingState;
+// Rings sit on a lattice of pitch gap + thickness that moves at a constant
+// speed from the reset time, so radii are a closed-form function of time.
+// A speed change rebases start_time onto the distance already travelled,
+// so the rings keep their phase instead of jumping. Render thread only.
+static double start_time = -1.0;
+static double start_travelled = 0.0;
+static float applied_speed = 0.0f;
+static uint32_t applied_reset_count = 0;
 
-static std::deque<RingState> rings;
-static double last_time = 0.0;
+namespace {
+const char* kRingsVertexShader = R"(
+#version 130
+out vec2 v_pixel;
+void main() {
+    v_pixel = gl_Vertex.xy;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
+}
+)";
+
+const char* kRingsFragmentShader = R"(
+#version 130
+in vec2 v_pixel;
+uniform vec2 u_center;
+uniform float u_first_radius;
+uniform float u_pitch;
+uniform float u_half_thickness;
+uniform float u_count;
+uniform vec4 u_color;
+void main() {
+    float d = length(v_pixel - u_center);
+    float k = clamp(floor((d - u_first_radius) / u_pitch + 0.5), 0.0, u_count - 1.0);
+    float dist = abs(d - (u_first_radius + k * u_pitch));
+    float coverage = clamp((u_half_thickness - dist) / max(fwidth(d), 1e-4) + 0.5, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+    gl_FragColor = vec4(u_color.rgb, u_color.a * coverage);
+}
+)";
+
+static bool shader_initialized = false;
+static GLuint program = 0;
+static GLint center_loc, first_radius_loc, pitch_loc, half_thickness_loc, count_loc, color_loc;
 
-static void ResetRings(float box_size, int n, float start_radius, float gap, float thick) {
-    rings.clear();
-    float r = start_radius + (n-1) * (gap + thick);
-    for (int i = n-1; i >= 0; --i) {
-        rings.push_front({r});
-        r -= (gap + thick);
+static void init_shader() {
+    shader_initialized = true;
+    program = CompileShaderProgram("concentric rings", kRingsVertexShader, kRingsFragmentShader);
+    if (!program) return;
+    center_loc = glGetUniformLocation(program, "u_center");
+    first_radius_loc = glGetUniformLocation(program, "u_first_radius");
+    pitch_loc = glGetUniformLocation(program, "u_pitch");
+    half_thickness_loc = glGetUniformLocation(program, "u_half_thickness");
+    count_loc = glGetUniformLocation(program, "u_count");
+    color_loc = glGetUniformLocation(program, "u_color");
+}
+
+// Immediate-mode stand-in for drivers without GLSL 130, one strip per ring
+static void draw_rings_fallback(float cx, float cy, double first, double pitch, double thick, int count,
+                                const ImVec4& color) {
+    glColor4f(color.x, color.y, color.z, color.w);
+    for (int i = 0; i < count; ++i) {
+        float radius = (float)(first + i * pitch);
+        float inner = radius - (float)thick * 0.5f;
+        float outer = radius + (float)thick * 0.5f;
+        glBegin(GL_TRIANGLE_STRIP);
+        for (int j = 0; j <= 128; ++j) {
+            float theta = 2.0f * 3.1415926f * j / 128.0f;
+            float x = cosf(theta);
+            float y = sinf(theta);
+            glVertex2f(cx + x * outer, cy + y * outer);
+            glVertex2f(cx + x * inner, cy + y * inner);
+        }
+        glEnd();
     }
 }
+}
 
 void RenderConcentricRingsControls() {
+    PROFILE_ZONE("RenderConcentricRingsControls");
     if (ImGui::Begin("Concentric Rings Controls")) {
         ImGui::Checkbox("Enable Concentric Rings", &rings_enabled);
         ImGui::SliderFloat2("Center (X,Y)", (float*)&center, 0.0f, 1.0f);
         ImGui::SliderFloat("Box Width", &box_width, 0.1f, 1.0f);
-        ImGui::SliderInt("Number of Rings", &num_rings, 1, 20);
+        ImGui::SliderInt("Number of Rings", &num_rings, 1, 500);
         ImGui::SliderFloat("Ring Radius", &ring_radius, 0.01f, 0.5f);
         ImGui::SliderFloat("Gap Between Rings", &ring_gap, 0.0f, 0.2f);
         ImGui::SliderFloat("Ring Thickness", &thickness, 0.001f, 0.1f);
-        ImGui::SliderFloat("Convergence Speed (px/s)", &shrink_speed, 1.0f, 500.0f);
+        ImGui::RadioButton("Contract", &expanding, 0); ImGui::SameLine();
+        ImGui::RadioButton("Expand", &expanding, 1);
+        ImGui::SliderFloat("Speed (px/s)", &shrink_speed, 1.0f, 500.0f);
         ImGui::ColorEdit4("Ring Color", (float*)&ring_color);
         if (ImGui::Button("Reset Rings")) {
-            float box_size = box_width * std::min(ImGui::GetIO().DisplaySize.x, ImGui::GetIO().DisplaySize.y);
-            float start_r = ring_radius * box_size;
-            float gap = ring_gap * box_size;
-            float thick = thickness * box_size;
-            ResetRings(box_size, num_rings, start_r, gap, thick);
+            reset_count++;
+        }
+        if (shader_initialized && !program) {
+            ImGui::TextColored(ImVec4(1, 1, 0, 1), "Rings shader unavailable, drawing in immediate mode without anti-aliasing");
         }
     }
     ImGui::End();
 }
 
-bool GetConcentricRingsEnabled() {
-    return rings_enabled;
+ConcentricRingsParams GetConcentricRingsParams() {
+    ConcentricRingsParams p;
+    p.enabled = rings_enabled;
+    p.center = center;
+    p.box_width = box_width;
+    p.num_rings = num_rings;
+    p.ring_radius = ring_radius;
+    p.ring_gap = ring_gap;
+    p.thickness = thickness;
+    p.speed = shrink_speed;
+    p.expanding = expanding != 0;
+    p.color = ring_color;
+    p.reset_count = reset_count;
+    return p;
 }
 
-void DrawConcentricRings(int width, int height, double time) {
-    if (!rings_enabled) return;
-    float box_size = box_width * std::min(width, height);
-    float cx = center.x * width;
-    float cy = center.y * height;
-    float start_radius = ring_radius * box_size;
-    float gap = ring_gap * box_size;
-    float thick = thickness * box_size;
-    if (rings.empty() || num_rings != (int)rings.size()) {
-        ResetRings(box_size, num_rings, start_radius, gap, thick);
-        last_time = time;
-    }
-    float dt = (float)(time - last_time);
-    last_time = time;
-    // Shrink all rings
-    for (auto& ring : rings) {
-        ring.radius -= shrink_speed * dt;
+void DrawConcentricRings(const ConcentricRingsParams& params, int width, int height, double time) {
+    PROFILE_ZONE("DrawConcentricRings");
+    if (!params.enabled) return;
+    if (!shader_initialized) init_shader();
+    if (start_time < 0.0 || params.reset_count != applied_reset_count) {
+        start_time = time;
+        start_travelled = 0.0;
+        applied_speed = params.speed;
+        applied_reset_count = params.reset_count;
+    } else if (params.speed != applied_speed) {
+        start_travelled += applied_speed * (time - start_time);
+        start_time = time;
+        applied_speed = params.speed;
     }
-    while (!rings.empty() && rings.front().radius < thick * 0.5f) {
-        rings.pop_front();
+
+    int num_rings = params.num_rings;
+    float box_size = params.box_width * std::min(width, height);
+    float cx = params.center.x * width;
+    float cy = params.center.y * height;
+    double start_radius = params.ring_radius * box_size;
+    double thick = params.thickness * box_size;
+    double pitch = params.ring_gap * box_size + thick;
+    double travelled = start_travelled + params.speed * (time - start_time);
+
+    // Contracting rings vanish once inside half a thickness and are replaced
+    // at the outside; expanding rings vanish past the initial outermost ring
+    // and are replaced at the inside.
+    double first, last;
+    if (!params.expanding) {
+        double base = start_radius - travelled;
+        first = base + std::max(0.0, std::ceil((thick * 0.5 - base) / pitch)) * pitch;
+        last = first + (num_rings - 1) * pitch;
+    } else {
+        double base = start_radius + travelled;
+        double outer_limit = start_radius + (num_rings - 1) * pitch;
+        last = base + std::floor((outer_limit - base) / pitch) * pitch;
+        first = last - (num_rings - 1) * pitch;
+        if (first < thick * 0.5) first += std::ceil((thick * 0.5 - first) / pitch) * pitch;
     }
-    
-    while ((int)rings.size() < num_rings) {
-        float outermost = rings.empty() ? start_radius : rings.back().radius;
-        float new_radius = outermost + gap + thick;
-        rings.push_back({new_radius});
+    int count = (int)std::floor((last - first) / pitch + 0.5) + 1;
+    if (count <= 0) return;
+    if (!program) {
+        draw_rings_fallback(cx, cy, first, pitch, thick, count, params.color);
+        return;
     }
 
-    glColor4f(ring_color.x, ring_color.y, ring_color.z, ring_color.w);
-    for (const auto& ring : rings) {
-        float inner = ring.radius - thick * 0.5f;
-        float outer = ring.radius + thick * 0.5f;
-        glBegin(GL_TRIANGLE_STRIP);
-        for (int j = 0; j <= 128; ++j) {
-            float theta = 2.0f * 3.1415926f * j / 128.0f;
-            float x = cosf(theta);
-            float y = sinf(theta);
-            glVertex2f(cx + x * outer, cy + y * outer);
-            glVertex2f(cx + x * inner, cy + y * inner);
-        }
-        glEnd();
-    }
+    glUseProgram(program);
+    glUniform2f(center_loc, cx, cy);
+    glUniform1f(first_radius_loc, (float)first);
+    glUniform1f(pitch_loc, (float)pitch);
+    glUniform1f(half_thickness_loc, (float)(thick * 0.5));
+    glUniform1f(count_loc, (float)count);
+    glUniform4f(color_loc, params.color.x, params.color.y, params.color.z, params.color.w);
+
+    // one quad bounding the outermost ring plus a pixel for anti-aliasing
+    float extent = (float)(last + thick * 0.5) + 1.0f;
+    glBegin(GL_QUADS);
+    glVertex2f(cx - extent, cy - extent);
+    glVertex2f(cx + extent, cy - extent);
+    glVertex2f(cx + extent, cy + extent);
+    glVertex2f(cx - extent, cy + extent);
+    glEnd();
+    glUseProgram(0);
 }
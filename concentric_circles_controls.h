@@ -1,6 +1,21 @@
 #pragma once
 #include <imgui.h>
+#include <cstdint>
 
-void DrawConcentricRings(int width, int height, double time);
+struct ConcentricRingsParams {
+    bool enabled;
+    ImVec2 center;
+    float box_width;
+    int num_rings;
+    float ring_radius;
+    float ring_gap;
+    float thickness;
+    float speed;
+    bool expanding;
+    ImVec4 color;
+    uint32_t reset_count;  // Reset Rings presses
+};
+
+void DrawConcentricRings(const ConcentricRingsParams& params, int width, int height, double time);
 void RenderConcentricRingsControls();
-bool GetConcentricRingsEnabled();
+ConcentricRingsParams GetConcentricRingsParams();
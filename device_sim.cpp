@@ -0,0 +1,590 @@
+// Software stand-ins for the pump and gate Arduinos on pseudo-terminals.
+//
+//   device_sim [--device pumps|gates|both] [--baud 1000000] [--boot-ms 1600]
+//              [--dir /tmp/spotlight-sim] [--quiet]
+//
+// Each device gets a pty whose slave end is linked as <dir>/pumps or
+// <dir>/gates; SerialPort::list_available_ports lists them next to the
+// real ttyUSB/ttyACM ports. The master end runs a line-for-line model of
+// arduino/pumps.ino or arduino/gates/gates.ino, including their timing:
+//
+//   - bytes take 10 bit times each way at --baud, and land in the 64-byte
+//     Arduino receive buffer, which overflows while the sketch is busy
+//   - opening the port resets the board (DTR); bytes sent during the
+//     --boot-ms bootloader window are lost
+//   - pumps.ino queues dispenses and steps them one at a time for
+//     cycles * 2 * (delay + ~4 us) each; serialEvent runs between steps,
+//     so echoes and acks go out while a dispense runs
+//   - gates.ino never blocks; each move eases over 2000 ms
+//
+// Runs until interrupted, then prints per-device totals.
+#include "serial_protocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+const int kRxBufferSize = 64;        // SERIAL_RX_BUFFER_SIZE in the AVR core
+const double kDigitalWriteUs = 4.0;  // one digitalWrite on a 16 MHz AVR
+const uint64_t kMaxWaitNs = 100000000;
+const uint64_t kNever = ~0ull;
+
+volatile sig_atomic_t running = 1;
+uint64_t start_ns = 0;
+bool quiet = false;
+
+struct Options {
+    bool pumps = true;
+    bool gates = true;
+    int baud = kDefaultBaudRate;
+    int boot_ms = 1600;
+    std::string dir = kSimulatedPortDir;
+};
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void log_event(const char* device, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+void log_event(const char* device, const char* fmt, ...) {
+    if (quiet) return;
+    char message[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    printf("[%10.3f %s] %s\n", (monotonic_ns() - start_ns) / 1e6, device, message);
+    fflush(stdout);
+}
+
+// The master end of a pty, playing the Arduino's UART
+class SimPort {
+public:
+    SimPort(const char* name, int baud) : overflow_bytes(0), mismatched_bytes(0), name_(name), baud_(baud),
+        byte_ns_(10000000000ull / baud), master_(-1), host_open_(false), warned_baud_(false), rx_wire_free_ns_(0), tx_wire_free_ns_(0) {}
+
+    bool open(const std::string& link) {
+        master_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master_ < 0 || grantpt(master_) != 0 || unlockpt(master_) != 0) {
+            perror("posix_openpt");
+            return false;
+        }
+        const char* slave = ptsname(master_);
+
+        // Raw until the host configures it, so nothing is echoed back at the host
+        int fd = ::open(slave, O_RDWR | O_NOCTTY);
+        if (fd < 0) {
+            perror(slave);
+            return false;
+        }
+        termios tty;
+        tcgetattr(fd, &tty);
+        cfmakeraw(&tty);
+        tcsetattr(fd, TCSANOW, &tty);
+        ::close(fd);
+
+        unlink(link.c_str());
+        if (symlink(slave, link.c_str()) != 0) {
+            perror(link.c_str());
+            return false;
+        }
+        link_ = link;
+        printf("%s: %s -> %s\n", name_, link.c_str(), slave);
+        fflush(stdout);
+        return true;
+    }
+
+    void close() {
+        if (!link_.empty()) unlink(link_.c_str());
+        if (master_ >= 0) ::close(master_);
+        master_ = -1;
+    }
+
+    // Reads what the host wrote and delivers bytes whose wire time has
+    // passed into the receive buffer. Returns true when the host has just
+    // opened the port, which resets an Arduino.
+    bool poll_host(uint64_t now) {
+        pollfd p = { master_, POLLIN, 0 };
+        poll(&p, 1, 0);
+        bool open_now = !(p.revents & POLLHUP);
+        bool opened = open_now && !host_open_;
+        if (host_open_ && !open_now) log_event(name_, "host closed the port");
+        host_open_ = open_now;
+
+        uint8_t buf[256];
+        ssize_t n;
+        while (host_open_ && (n = ::read(master_, buf, sizeof(buf))) > 0) {
+            if (!host_baud_matches()) {
+                mismatched_bytes += n;
+                continue;
+            }
+            for (ssize_t i = 0; i < n; ++i) {
+                rx_wire_free_ns_ = std::max(rx_wire_free_ns_, now) + byte_ns_;
+                wire_rx_.push_back(std::make_pair(rx_wire_free_ns_, buf[i]));
+            }
+        }
+        while (!wire_rx_.empty() && wire_rx_.front().first <= now) {
+            if ((int)rx_.size() < kRxBufferSize) rx_.push_back(wire_rx_.front().second);
+            else overflow_bytes++;
+            wire_rx_.pop_front();
+        }
+        return opened;
+    }
+
+    // Everything received so far is lost, as in the bootloader
+    void discard() {
+        rx_.clear();
+    }
+
+    int available() const { return (int)rx_.size(); }
+
+    int read() {
+        if (rx_.empty()) return -1;
+        int c = rx_.front();
+        rx_.pop_front();
+        return c;
+    }
+
+    void write(const uint8_t* data, size_t size, uint64_t now) {
+        for (size_t i = 0; i < size; ++i) {
+            tx_wire_free_ns_ = std::max(tx_wire_free_ns_, now) + byte_ns_;
+            wire_tx_.push_back(std::make_pair(tx_wire_free_ns_, data[i]));
+        }
+    }
+
+    void print(const std::string& line, uint64_t now) {
+        std::string out = line + "\r\n";  // Serial.println
+        write((const uint8_t*)out.data(), out.size(), now);
+    }
+
+    // Hands the host whatever has finished crossing the wire
+    void flush(uint64_t now) {
+        uint8_t buf[256];
+        size_t n = 0;
+        while (!wire_tx_.empty() && wire_tx_.front().first <= now && n < sizeof(buf)) {
+            buf[n++] = wire_tx_.front().second;
+            wire_tx_.pop_front();
+        }
+        if (n > 0 && host_open_ && ::write(master_, buf, n) < 0 && errno != EAGAIN) perror(name_);
+    }
+
+    uint64_t next_event_ns() const {
+        uint64_t next = kNever;
+        if (!wire_rx_.empty()) next = std::min(next, wire_rx_.front().first);
+        if (!wire_tx_.empty()) next = std::min(next, wire_tx_.front().first);
+        return next;
+    }
+
+    // Sleeps until deadline_ns or until the host writes something
+    void wait(uint64_t now, uint64_t deadline_ns) {
+        uint64_t wait_ns = std::min(deadline_ns > now ? deadline_ns - now : 0, kMaxWaitNs);
+        if (!host_open_) {
+            // The master reports POLLHUP while no one has the slave open
+            usleep(20000);
+            return;
+        }
+        timespec ts = { (time_t)(wait_ns / 1000000000ull), (long)(wait_ns % 1000000000ull) };
+        pollfd p = { master_, POLLIN, 0 };
+        ppoll(&p, 1, &ts, nullptr);
+    }
+
+    const char* name() const { return name_; }
+
+    uint64_t overflow_bytes;    // lost to a full receive buffer
+    uint64_t mismatched_bytes;  // sent at a different baud rate than the sketch's
+
+private:
+    // A UART at the wrong rate reads framing errors; drop the bytes
+    bool host_baud_matches() {
+        termios tty;
+        speed_t expected;
+        if (tcgetattr(master_, &tty) != 0 || !BaudRateConstant(baud_, expected)) return true;
+        bool match = cfgetospeed(&tty) == expected;
+        if (!match && !warned_baud_) {
+            log_event(name_, "host is not at %d baud; its bytes are garbage to the sketch", baud_);
+        }
+        warned_baud_ = !match;
+        return match;
+    }
+
+    const char* name_;
+    int baud_;
+    uint64_t byte_ns_;
+    int master_;
+    std::string link_;
+    bool host_open_;
+    bool warned_baud_;
+    std::deque<std::pair<uint64_t, uint8_t> > wire_rx_, wire_tx_;
+    uint64_t rx_wire_free_ns_, tx_wire_free_ns_;
+    std::deque<uint8_t> rx_;
+};
+
+void send_ack(SimPort& port, uint8_t seq, uint8_t type, uint64_t now) {
+    uint8_t payload[2] = { kFrameAck, type };
+    uint8_t frame[kMaxFrameSize];
+    size_t n = EncodeFrame(seq, payload, sizeof(payload), frame);
+    port.write(frame, n, now);
+}
+
+uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Arduino String::toInt: atol of the substring
+long to_int(const std::string& s, size_t from, size_t to = std::string::npos) {
+    if (from >= s.size()) return 0;
+    return atol(s.substr(from, to == std::string::npos ? std::string::npos : to - from).c_str());
+}
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    return s.substr(b, s.find_last_not_of(" \t\r\n") - b + 1);
+}
+
+// arduino/pumps.ino
+class PumpsSketch {
+public:
+    PumpsSketch() { reset(); }
+
+    void reset() {
+        input_string_.clear();
+        string_complete_ = false;
+        binary_ = false;
+        parser_.reset();
+        pending_.clear();
+        stepping_until_ = 0;
+    }
+
+    // serialEvent() then loop(), as the Arduino core calls them. A running
+    // dispense is one deadline; the passes that step it never block.
+    uint64_t step(SimPort& port, uint64_t now) {
+        serial_event(port, now);
+
+        if (string_complete_) {
+            process_command(input_string_);
+            input_string_.clear();
+            string_complete_ = false;
+        }
+        if (stepping_until_ != 0 && now >= stepping_until_) stepping_until_ = 0;
+        if (stepping_until_ == 0 && !pending_.empty()) {
+            const PumpCommand& c = pending_.front();
+            uint64_t busy_us = run_pump(c.pump, c.push, c.cycles, c.delay_us);
+            if (busy_us > 0) stepping_until_ = now + busy_us * 1000;
+            pending_.pop_front();
+        }
+        return now;
+    }
+
+    // End of the running dispense, so the next one starts on time
+    uint64_t next_event_ns() const {
+        return stepping_until_ != 0 ? stepping_until_ : kNever;
+    }
+
+    uint64_t commands = 0;
+
+private:
+    struct PumpCommand {
+        char pump;
+        bool push;
+        unsigned long cycles, delay_us;
+    };
+    static const size_t kPendingSize = 8;  // one slot stays empty, as in the sketch
+
+    void serial_event(SimPort& port, uint64_t now) {
+        int c;
+        while ((c = port.read()) >= 0) {
+            if (binary_) {
+                if (parser_.feed((uint8_t)c)) process_frame(port, now);
+            } else if (c == '\n') {
+                input_string_ = trim(input_string_);
+                if (input_string_ == "~~") {
+                    binary_ = true;
+                    input_string_.clear();
+                    send_ack(port, 0, kFrameHello, now);
+                    log_event(port.name(), "switched to binary");
+                    continue;
+                }
+                string_complete_ = true;
+                port.print(input_string_, now);
+            } else {
+                input_string_ += (char)c;
+            }
+        }
+    }
+
+    void process_frame(SimPort& port, uint64_t now) {
+        const uint8_t* p = parser_.payload();
+        if (parser_.size() == 11 && p[0] == kFramePump) {
+            if (!valid_pump(p[1]) || pending_.size() >= kPendingSize - 1) return;
+            PumpCommand c = { (char)p[1], p[2] == 'h', get_u32(p + 3), get_u32(p + 7) };
+            pending_.push_back(c);
+            send_ack(port, parser_.seq(), kFramePump, now);
+        } else if (parser_.size() == 1 && p[0] == kFrameHello) {
+            send_ack(port, parser_.seq(), kFrameHello, now);
+        }
+    }
+
+    static bool valid_pump(char pump) {
+        return pump == 'x' || pump == 'y' || pump == 'z' || pump == 'a';
+    }
+
+    void process_command(const std::string& line) {
+        std::string cmd = trim(line);
+        if (cmd.size() < 3) return;
+        char pump = cmd[1];
+        if (!valid_pump(pump)) return;
+
+        size_t first_space = cmd.find(' ', 2);
+        if (first_space == std::string::npos) return;
+        size_t second_space = cmd.find(' ', first_space + 1);
+        if (second_space == std::string::npos) second_space = cmd.size();
+
+        long cycles = to_int(cmd, first_space + 1, second_space);
+        long delay_us = to_int(cmd, second_space + 1);
+        if (cycles <= 0 || delay_us < 0 || pending_.size() >= kPendingSize - 1) return;
+        PumpCommand c = { pump, cmd[0] == 'h', (unsigned long)cycles, (unsigned long)delay_us };
+        pending_.push_back(c);
+    }
+
+    uint64_t run_pump(char pump, bool push, long cycles, long delay_us) {
+        commands++;
+        if (cycles <= 0) return 0;
+        double busy_us = cycles * 2.0 * (delay_us + kDigitalWriteUs);
+        log_event("pumps", "%c %s %ld cycles at %ld us, busy %.1f ms", pump, push ? "push" : "pull", cycles, delay_us, busy_us / 1000.0);
+        return (uint64_t)busy_us;
+    }
+
+    std::string input_string_;
+    bool string_complete_;
+    bool binary_;
+    FrameParser parser_;
+    std::deque<PumpCommand> pending_;  // started dispenses leave it, as in the sketch
+    uint64_t stepping_until_;          // 0 when no dispense is running
+};
+
+// arduino/gates/gates.ino
+class GatesSketch {
+public:
+    GatesSketch() { reset(); }
+
+    void reset() {
+        for (int i = 0; i < 3; ++i) {
+            gates_[i] = Gate();
+        }
+        input_buffer_.clear();
+        binary_ = false;
+        probe_chars_ = 0;
+        parser_.reset();
+    }
+
+    // One pass of loop(); it never blocks
+    uint64_t step(SimPort& port, uint64_t now) {
+        int c;
+        while ((c = port.read()) >= 0) {
+            if (binary_) {
+                if (parser_.feed((uint8_t)c)) process_frame(port, now);
+            } else if (c == '~') {
+                if (++probe_chars_ == 2) {
+                    binary_ = true;
+                    input_buffer_.clear();
+                    send_ack(port, 0, kFrameHello, now);
+                    log_event(port.name(), "switched to binary");
+                }
+            } else {
+                probe_chars_ = 0;
+                if (isalnum(c)) input_buffer_ += (char)c;
+            }
+        }
+        while (input_buffer_.size() >= 2) {
+            handle_pair(input_buffer_[0], input_buffer_[1], now);
+            input_buffer_.erase(0, 2);
+        }
+        animate(now);
+        return now;
+    }
+
+    // End of the next move, so its arrival is logged on time
+    uint64_t next_event_ns() const {
+        uint64_t next = kNever;
+        for (int i = 0; i < 3; ++i) {
+            if (gates_[i].moving) next = std::min(next, gates_[i].start_ns + (uint64_t)kDurationMs * 1000000 + 1);
+        }
+        return next;
+    }
+
+    uint64_t commands = 0;
+
+private:
+    static const int kClosedPulse = 1000;
+    static const int kOpenPulse = 1600;
+    static const int kDurationMs = 2000;
+
+    struct Gate {
+        int start_pulse = kClosedPulse;
+        int end_pulse = kOpenPulse;
+        int current_pulse = kClosedPulse;
+        uint64_t start_ns = 0;
+        bool moving = false;
+    };
+
+    void process_frame(SimPort& port, uint64_t now) {
+        const uint8_t* p = parser_.payload();
+        if (parser_.size() >= 1 && p[0] == kFrameDoor) {
+            for (int i = 1; i + 1 < parser_.size(); i += 2) {
+                handle_pair(p[i], p[i + 1], now);
+            }
+            send_ack(port, parser_.seq(), kFrameDoor, now);
+        } else if (parser_.size() == 1 && p[0] == kFrameHello) {
+            send_ack(port, parser_.seq(), kFrameHello, now);
+        }
+    }
+
+    void handle_pair(char action, char gate_char, uint64_t now) {
+        commands++;
+        if (gate_char < '1' || gate_char > '3') return;
+        Gate& g = gates_[gate_char - '1'];
+        bool open = action == 'o' || action == 'O';
+        bool close = action == 'c' || action == 'C';
+        int target = open ? kOpenPulse : kClosedPulse;
+        if ((open || close) && g.current_pulse != target) {
+            g.start_pulse = g.current_pulse;
+            g.end_pulse = target;
+            g.start_ns = now;
+            g.moving = true;
+            log_event("gates", "gate %c %s from %d us", gate_char, open ? "opening" : "closing", g.start_pulse);
+        }
+    }
+
+    void animate(uint64_t now) {
+        for (int i = 0; i < 3; ++i) {
+            Gate& g = gates_[i];
+            if (!g.moving) continue;
+            uint64_t elapsed_ms = (now - g.start_ns) / 1000000;
+            if (elapsed_ms <= (uint64_t)kDurationMs) {
+                float t = (float)elapsed_ms / kDurationMs;
+                float eased = 0.5f * (1 - cosf((float)M_PI * t));
+                g.current_pulse = g.start_pulse + (int)((g.end_pulse - g.start_pulse) * eased);
+            } else {
+                g.current_pulse = g.end_pulse;
+                g.moving = false;
+                log_event("gates", "gate %d %s", i + 1, g.end_pulse == kOpenPulse ? "open" : "closed");
+            }
+        }
+    }
+
+    Gate gates_[3];
+    std::string input_buffer_;
+    bool binary_;
+    int probe_chars_;
+    FrameParser parser_;
+};
+
+uint64_t sketch_timer(const PumpsSketch& pumps) { return pumps.next_event_ns(); }
+uint64_t sketch_timer(const GatesSketch& gates) { return gates.next_event_ns(); }
+
+template <typename Sketch>
+void run_device(SimPort* port, Sketch* sketch, int boot_ms) {
+    uint64_t boot_until = 0;
+    uint64_t busy_until = 0;
+    while (running) {
+        uint64_t now = monotonic_ns();
+        if (port->poll_host(now)) {
+            sketch->reset();
+            boot_until = now + (uint64_t)boot_ms * 1000000;
+            busy_until = boot_until;
+            log_event(port->name(), "host opened the port, rebooting");
+        }
+        if (now < boot_until) port->discard();
+        if (now >= busy_until) busy_until = sketch->step(*port, now);
+        port->flush(now);
+
+        uint64_t wake = std::min(port->next_event_ns(), sketch_timer(*sketch));
+        if (busy_until > now) wake = std::min(wake, busy_until);
+        port->wait(monotonic_ns(), wake);
+    }
+}
+
+void stop(int) { running = 0; }
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--device" && has_value) {
+            std::string device = argv[++i];
+            opt.pumps = device == "pumps" || device == "both";
+            opt.gates = device == "gates" || device == "both";
+            if (!opt.pumps && !opt.gates) return false;
+        } else if (arg == "--baud" && has_value) {
+            opt.baud = std::atoi(argv[++i]);
+        } else if (arg == "--boot-ms" && has_value) {
+            opt.boot_ms = std::atoi(argv[++i]);
+        } else if (arg == "--dir" && has_value) {
+            opt.dir = argv[++i];
+        } else if (arg == "--quiet") {
+            quiet = true;
+        } else {
+            return false;
+        }
+    }
+    return opt.baud > 0;
+}
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        fprintf(stderr, "usage: %s [--device pumps|gates|both] [--baud 1000000] [--boot-ms 1600]\n"
+                        "       [--dir %s] [--quiet]\n", argv[0], kSimulatedPortDir);
+        return 1;
+    }
+    start_ns = monotonic_ns();
+    prctl(PR_SET_TIMERSLACK, 1);  // wire times are tens of microseconds
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    mkdir(opt.dir.c_str(), 0755);
+
+    SimPort pump_port("pumps", opt.baud);
+    SimPort gate_port("gates", opt.baud);
+    PumpsSketch pumps;
+    GatesSketch gates;
+    std::vector<std::thread> threads;
+    bool ok = true;
+    if (opt.pumps && (ok = pump_port.open(opt.dir + "/pumps"))) {
+        threads.push_back(std::thread(run_device<PumpsSketch>, &pump_port, &pumps, opt.boot_ms));
+    }
+    if (ok && opt.gates && (ok = gate_port.open(opt.dir + "/gates"))) {
+        threads.push_back(std::thread(run_device<GatesSketch>, &gate_port, &gates, opt.boot_ms));
+    }
+    if (!ok) running = 0;
+
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    pump_port.close();
+    gate_port.close();
+
+    if (opt.pumps) printf("pumps: %llu commands, %llu bytes lost to receive buffer overflow, %llu at the wrong baud rate\n",
+                          (unsigned long long)pumps.commands, (unsigned long long)pump_port.overflow_bytes,
+                          (unsigned long long)pump_port.mismatched_bytes);
+    if (opt.gates) printf("gates: %llu commands, %llu bytes lost to receive buffer overflow, %llu at the wrong baud rate\n",
+                          (unsigned long long)gates.commands, (unsigned long long)gate_port.overflow_bytes,
+                          (unsigned long long)gate_port.mismatched_bytes);
+    return ok ? 0 : 1;
+}
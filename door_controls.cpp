@@ -1,4 +1,5 @@
 #include "door_controls.h"
+#include "profiler.h"
 #include "serial/serial.h"
 #include "imgui.h"
 #include <vector>
@@ -7,14 +8,16 @@
 namespace {
 static SerialPort serial_door;
 static int selected_door_port = -1;
+static int door_baud_index = DefaultBaudRateIndex();
+static bool door_use_binary = true;
 static std::vector<std::string> door_port_list;
 static int object_limit = 3;
-static int prev_count = -1;
 static bool manual_override = false; // Manual override flag
 static bool door_selected[3] = {false, false, false}; // Selection state for doors 1, 2, 3
 }
 
 void RenderDoorControls() {
+    PROFILE_ZONE("RenderDoorControls");
     ImGui::Begin("Door Control");
     if (ImGui::Button("Scan Ports")) {
         door_port_list = SerialPort::list_available_ports();
@@ -25,13 +28,35 @@ void RenderDoorControls() {
             selected_door_port = i;
         }
     }
+    if (!serial_door.is_open()) {
+        ImGui::Combo("Baud", &door_baud_index, kBaudRateLabels, kBaudRateCount);
+        ImGui::Checkbox("Binary protocol", &door_use_binary);
+    }
     if (selected_door_port >= 0 && !serial_door.is_open()) {
-        if (ImGui::Button("Open Door Port")) {
-            serial_door.open(door_port_list[selected_door_port]);
+        if (ImGui::Button("Open Door Port") &&
+            serial_door.open(door_port_list[selected_door_port], kBaudRates[door_baud_index])) {
+            if (door_use_binary) serial_door.negotiate_binary(3000);
         }
     }
     if (serial_door.is_open()) {
-        ImGui::Text("Door Port Open");
+        ImGui::Text("Door Port Open at %d baud, %s", serial_door.baud_rate(),
+                    serial_door.is_negotiating() ? "negotiating binary..." : serial_door.is_binary() ? "binary" : "ASCII");
+        SerialPort::Stats stats = serial_door.stats();
+        ImGui::Text("Sent %llu commands in %llu writes, %llu dropped, %llu failed",
+                    (unsigned long long)stats.queued, (unsigned long long)stats.writes,
+                    (unsigned long long)stats.dropped, (unsigned long long)stats.errors);
+        if (serial_door.is_binary()) {
+            SerialPort::AckStats acks = serial_door.ack_stats();
+            ImGui::Text("Acks %llu, in flight %d; RTT last %.2f ms, mean %.2f ms, max %.2f ms",
+                        (unsigned long long)acks.acked, acks.in_flight, acks.last_rtt_ms, acks.mean_rtt_ms, acks.max_rtt_ms);
+            if (acks.late > 0 || acks.lost > 0) {
+                ImGui::TextColored(ImVec4(1, 0, 0, 1), "%llu late (> %d ms), %llu lost (no ack in %d ms)",
+                                   (unsigned long long)acks.late, SerialPort::kLateAckMs,
+                                   (unsigned long long)acks.lost, SerialPort::kLostAckMs);
+            }
+        } else if (!serial_door.is_negotiating()) {
+            ImGui::TextColored(ImVec4(1, 1, 0, 1), "No door acks in ASCII mode");
+        }
         if (ImGui::Button("Close Door Port")) {
             serial_door.close();
         }
@@ -125,9 +150,14 @@ void RenderDoorControls() {
 }
 
 // Interface implementations
+DoorParams GetDoorParams() {
+    DoorParams p;
+    p.manual_override = manual_override;
+    p.object_limit = object_limit;
+    return p;
+}
+
 bool IsDoorSerialOpen() { return serial_door.is_open(); }
 void SendDoorCommand(const std::string& command) { serial_door.send_door_command(command); }
 int GetObjectLimit() { return object_limit; }
 void SetObjectLimit(int value) { object_limit = value; }
-int& RefPrevCount() { return prev_count; }
-bool IsManualOverride() { return manual_override; }
@@ -3,10 +3,14 @@
 
 void RenderDoorControls();
 
-// Door state interface for main loop
+// Automatic door control settings for the render thread
+struct DoorParams {
+    bool manual_override;
+    int object_limit;
+};
+
+DoorParams GetDoorParams();
 bool IsDoorSerialOpen();
 void SendDoorCommand(const std::string& command);
 int GetObjectLimit();
 void SetObjectLimit(int value);
-int& RefPrevCount();
-bool IsManualOverride();
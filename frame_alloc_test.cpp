@@ -0,0 +1,104 @@
+// Checks that the per-frame object path stops allocating after warm-up.
+//
+//   frame_alloc_test [--objects 10000] [--frames 1000] [--seed 1]
+//
+// Built with SPOTLIGHT_COUNT_ALLOCATIONS. Feeds synthetic frames of varying
+// size through what the reader and render threads do per frame: tracking,
+// motion prediction, projection and ring instances in a FrameArena. Every
+// frame's allocation count goes to RecordFrameAllocations with fail-fast on,
+// as --fail-on-alloc does in spotlight, so an allocation after warm-up
+// aborts with the frame number.
+#include "alloc_counter.h"
+#include "box_reader.h"
+#include "frame_arena.h"
+#include "motion_predictor.h"
+#include "projection.h"
+#include "ring_renderer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace {
+const int kWarmupFrames = 120;  // as alloc_counter.cpp
+const uint64_t kFrameUs = 10000;
+
+static BoxFrame frame;
+}
+
+int main(int argc, char** argv) {
+    int max_objects = 10000;
+    int frames = 1000;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--objects") && i + 1 < argc) {
+            max_objects = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = (unsigned)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--objects 10000] [--frames 1000] [--seed 1]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_objects < 1 || max_objects > kMaxFrameObjects) {
+        fprintf(stderr, "--objects must be 1..%d\n", kMaxFrameObjects);
+        return 1;
+    }
+
+    // A counter that never moves would pass everything
+    uint64_t before = ThreadAllocationCount();
+    ::operator delete(::operator new(1));  // a call, unlike a new-expression, is never elided
+    if (!AllocationCountingEnabled() || ThreadAllocationCount() == before) {
+        fprintf(stderr, "allocation counting is not compiled in\n");
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> coord(0.0f, 2048.0f);
+    std::uniform_real_distribution<float> step(-3.0f, 3.0f);
+    std::uniform_int_distribution<int> size(0, max_objects);
+    for (int i = 0; i < max_objects; ++i) {
+        frame.objects[i].rect.x = coord(rng);
+        frame.objects[i].rect.y = coord(rng);
+        frame.objects[i].rect.width = 12.0f;
+        frame.objects[i].rect.height = 12.0f;
+    }
+
+    // Starts small so the arena has to grow during warm-up
+    FrameArena arena(4096);
+    CalibrationTransform t = MakeCalibrationTransform(545.0f, 379.0f, 1254.0f, 1920, 1080);
+    SetAllocationFailFast(true);
+
+    uint64_t timestamp_us = 0;
+    for (int f = 0; f < kWarmupFrames + frames; ++f) {
+        uint64_t allocations_before = ThreadAllocationCount();
+        arena.reset();
+
+        // The largest frame comes first; later ones vary below it
+        int count = f == 0 ? max_objects : size(rng);
+        for (int i = 0; i < count; ++i) {
+            frame.objects[i].rect.x += step(rng);
+            frame.objects[i].rect.y += step(rng);
+        }
+        timestamp_us += kFrameUs;
+        frame.count = count;
+        frame.writer_timestamp = timestamp_us;
+        frame.sequence = f + 1;
+        UpdateObjectTracks(frame.objects, count, timestamp_us, frame.tracked);
+
+        const ImVec2* centers = PredictBoxCenters(frame, timestamp_us + 8000);
+        float* x = arena.alloc<float>(count);
+        float* y = arena.alloc<float>(count);
+        ProjectPoints(reinterpret_cast<const float*>(centers), count, t, x, y);
+        RingInstance* rings = arena.alloc<RingInstance>(count);
+        for (int i = 0; i < count; ++i) rings[i] = { x[i], y[i], 20.0f, 0.8f, 0.0f };
+
+        RecordFrameAllocations(ThreadAllocationCount() - allocations_before);
+    }
+
+    printf("%d frames of up to %d objects, no allocations after %d warm-up frames (arena %zu bytes)\n",
+           frames, max_objects, kWarmupFrames, arena.capacity());
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for scratch arrays that only live for one frame. reset()
+// at the start of a frame hands the whole block back at once; nothing is
+// freed individually. A frame that outgrows the block spills to the heap
+// and the block is enlarged at the next reset, so once the working set is
+// known, frames do not allocate at all. Not thread safe; one per thread.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity = 1 << 20) : block_(capacity), used_(0), peak_(0) {}
+
+    // Uninitialised storage for count objects of T
+    template <typename T>
+    T* alloc(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destroyed");
+        const size_t align = alignof(T) > kMinAlign ? alignof(T) : kMinAlign;
+        size_t offset = (used_ + align - 1) & ~(align - 1);
+        size_t bytes = count * sizeof(T);
+        peak_ = offset + bytes > peak_ ? offset + bytes : peak_;
+        if (offset + bytes <= block_.size()) {
+            used_ = offset + bytes;
+            return reinterpret_cast<T*>(block_.data() + offset);
+        }
+        used_ = offset + bytes;
+        overflow_.emplace_back(new unsigned char[bytes + align]);
+        size_t base = reinterpret_cast<size_t>(overflow_.back().get());
+        return reinterpret_cast<T*>((base + align - 1) & ~(align - 1));
+    }
+
+    void reset() {
+        if (!overflow_.empty()) {
+            overflow_.clear();
+            block_.assign(peak_ * 2, 0);
+        }
+        used_ = 0;
+    }
+
+    size_t used() const { return used_; }
+    size_t capacity() const { return block_.size(); }
+
+private:
+    static const size_t kMinAlign = 16;
+
+    std::vector<unsigned char> block_;  // new[] storage is aligned for any fundamental type
+    size_t used_;
+    size_t peak_;  // largest single-frame footprint seen
+    std::vector<std::unique_ptr<unsigned char[]>> overflow_;
+};
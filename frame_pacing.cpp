@@ -0,0 +1,122 @@
+#include "frame_pacing.h"
+#include "profiler.h"
+#include "shaman/shaman.h"
+#include "imgui.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+const char* const kFramePacingModeNames[PACING_MODE_COUNT] = { "Uncapped", "VSync", "Just in Time" };
+
+namespace {
+// Set from the UI
+static std::atomic<int> pacing_mode{PACING_UNCAPPED};
+static std::atomic<int> safety_margin_us{1000};
+static std::atomic<int> spin_us{200};
+
+// Reported to the UI
+static std::atomic<int> refresh_period_us{16667};
+static std::atomic<int> render_cost_us{0};
+static std::atomic<uint64_t> paced_frames{0};
+static std::atomic<uint64_t> missed_vblanks{0};
+static std::atomic<int> last_sleep_us{0};
+
+// Render thread only
+static int applied_mode = -1;
+static FramePacingMode frame_mode = PACING_UNCAPPED;
+static double period_us = 16667.0;
+static double cost_us = 0.0;
+static uint64_t last_vblank_us = 0;
+static uint64_t wake_us = 0;
+static uint64_t target_vblank_us = 0;
+
+static void sleep_until(uint64_t target_us) {
+    uint64_t now = get_time_us();
+    int spin = spin_us;
+    if (target_us > now + spin) {
+        std::this_thread::sleep_for(std::chrono::microseconds(target_us - now - spin));
+    }
+    while (get_time_us() < target_us) {
+    }
+}
+}
+
+FramePacingMode BeginPacedFrame() {
+    frame_mode = (FramePacingMode)pacing_mode.load();
+    if (frame_mode != applied_mode) {
+        glfwSwapInterval(frame_mode == PACING_UNCAPPED ? 0 : 1);
+        applied_mode = frame_mode;
+        last_vblank_us = 0;
+    }
+
+    wake_us = get_time_us();
+    target_vblank_us = 0;
+    if (frame_mode == PACING_JUST_IN_TIME && last_vblank_us != 0) {
+        // Earliest vblank we can still make with the expected render cost
+        uint64_t lead = (uint64_t)(cost_us + safety_margin_us);
+        uint64_t vblank = last_vblank_us + (uint64_t)period_us;
+        while (vblank < wake_us + lead) vblank += (uint64_t)period_us;
+        target_vblank_us = vblank;
+        last_sleep_us = (int)(vblank - lead - wake_us);
+        sleep_until(vblank - lead);
+        wake_us = get_time_us();
+    } else {
+        last_sleep_us = 0;
+    }
+    return frame_mode;
+}
+
+void EndPacedFrame(uint64_t submitted_us, uint64_t swapped_us) {
+    // Decaying maximum, so one slow frame raises the budget immediately and
+    // it relaxes over a few seconds
+    double cost = submitted_us > wake_us ? (double)(submitted_us - wake_us) : 0.0;
+    cost_us = std::max(cost, cost_us * 0.995);
+    render_cost_us = (int)cost_us;
+
+    if (frame_mode == PACING_UNCAPPED) return;
+
+    // With vsync on and the pipeline drained, swap completion marks a vblank
+    if (last_vblank_us != 0) {
+        double interval = (double)(swapped_us - last_vblank_us);
+        double frames = interval / period_us;
+        double whole = std::max(1.0, (double)(int)(frames + 0.5));
+        if (frames > 0.5 && std::abs(frames - whole) < 0.25) {
+            period_us += (interval / whole - period_us) / 32.0;
+            refresh_period_us = (int)period_us;
+        }
+    }
+    if (frame_mode == PACING_JUST_IN_TIME && target_vblank_us != 0 &&
+        swapped_us > target_vblank_us + (uint64_t)(period_us / 2)) {
+        missed_vblanks++;
+    }
+    last_vblank_us = swapped_us;
+    paced_frames++;
+}
+
+void SetDisplayRefreshRate(int hz) {
+    if (hz <= 0) return;
+    period_us = 1e6 / hz;
+    refresh_period_us = (int)period_us;
+}
+
+void RenderFramePacingControls() {
+    PROFILE_ZONE("RenderFramePacingControls");
+    ImGui::Begin("Frame Pacing");
+    int mode = pacing_mode;
+    if (ImGui::Combo("Mode", &mode, kFramePacingModeNames, PACING_MODE_COUNT)) pacing_mode = mode;
+    int margin = safety_margin_us;
+    if (ImGui::SliderInt("Safety Margin (us)", &margin, 0, 8000)) safety_margin_us = margin;
+    int spin = spin_us;
+    if (ImGui::SliderInt("Final Spin (us)", &spin, 0, 2000)) spin_us = spin;
+    ImGui::Separator();
+    int period = refresh_period_us;
+    ImGui::Text("Refresh period: %.3f ms (%.2f Hz)", period / 1000.0, period > 0 ? 1e6 / period : 0.0);
+    ImGui::Text("Render cost budget: %.2f ms", render_cost_us / 1000.0);
+    ImGui::Text("Last sleep: %.2f ms", last_sleep_us / 1000.0);
+    ImGui::Text("Paced frames: %llu, missed vblanks: %llu",
+                (unsigned long long)paced_frames.load(), (unsigned long long)missed_vblanks.load());
+    ImGui::End();
+}
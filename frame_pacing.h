@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+enum FramePacingMode {
+    PACING_UNCAPPED,      // no vsync, render as fast as possible (tears)
+    PACING_VSYNC,         // vsync, render right after the previous swap
+    PACING_JUST_IN_TIME,  // vsync, sleep until just before the next vblank, then latch input
+    PACING_MODE_COUNT
+};
+
+extern const char* const kFramePacingModeNames[PACING_MODE_COUNT];
+
+// Render thread, around each spotlight frame. BeginPacedFrame applies the
+// swap interval and, in just-in-time mode, sleeps until the predicted start
+// of the render window; sample input after it returns. Call EndPacedFrame
+// once the swap has completed.
+FramePacingMode BeginPacedFrame();
+void EndPacedFrame(uint64_t submitted_us, uint64_t swapped_us);
+
+// Nominal refresh rate of the spotlight monitor, before any measurement
+void SetDisplayRefreshRate(int hz);
+
+void RenderFramePacingControls();
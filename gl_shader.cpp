@@ -0,0 +1,59 @@
+#include "gl_shader.h"
+#include <iostream>
+#include <vector>
+
+namespace {
+GLuint compile_stage(const char* name, GLenum type, const char* src) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &src, nullptr);
+    glCompileShader(shader);
+
+    GLint ok = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length + 1, '\0');
+        glGetShaderInfoLog(shader, length, nullptr, log.data());
+        std::cerr << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+                  << " shader for " << name << ":\n" << log.data() << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+}
+
+GLuint CompileShaderProgram(const char* name, const char* vertex_src, const char* fragment_src,
+                            const char* const* attributes, int attribute_count) {
+    GLuint vs = compile_stage(name, GL_VERTEX_SHADER, vertex_src);
+    GLuint fs = compile_stage(name, GL_FRAGMENT_SHADER, fragment_src);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    for (int i = 0; i < attribute_count; ++i) {
+        glBindAttribLocation(program, i, attributes[i]);
+    }
+    glLinkProgram(program);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+
+    GLint ok = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> log(length + 1, '\0');
+        glGetProgramInfoLog(program, length, nullptr, log.data());
+        std::cerr << "Failed to link shader program " << name << ":\n" << log.data() << "\n";
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <GL/glew.h>
+
+// Compile and link a vertex/fragment program. Attribute names are bound to
+// locations 0..n-1 in order before linking. Returns 0 and logs on failure.
+GLuint CompileShaderProgram(const char* name, const char* vertex_src, const char* fragment_src,
+                            const char* const* attributes = nullptr, int attribute_count = 0);
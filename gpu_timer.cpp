@@ -0,0 +1,111 @@
+#include "gpu_timer.h"
+#include "profiler.h"
+#include "latency_stats.h"
+#include "imgui.h"
+#include <GL/glew.h>
+#include <atomic>
+#include <iostream>
+
+namespace {
+static const char* layer_names[GPU_LAYER_COUNT] = {
+    "Gratings", "Concentric Rings", "Salesman", "Tracked Rings", "Central Circle", "Calibration", "Warp"
+};
+
+// Results are read back this many frames after they were issued
+const int kQueryFrames = 4;
+
+static std::atomic<bool> timing_enabled{true};
+static RollingStats layer_stats[GPU_LAYER_COUNT];
+static RollingStats frame_stats;
+static std::atomic<uint64_t> dropped{0};
+
+// Render thread only
+static bool initialized = false;
+static bool supported = false;
+static GLuint queries[kQueryFrames][GPU_LAYER_COUNT];
+static bool issued[kQueryFrames][GPU_LAYER_COUNT];
+static int frame_slot = 0;
+static int active_layer = -1;
+
+static void init() {
+    initialized = true;
+    if (!GLEW_VERSION_3_3 && !GLEW_ARB_timer_query) {
+        std::cerr << "GL timer queries unavailable, GPU layer timing disabled\n";
+        return;
+    }
+    glGenQueries(kQueryFrames * GPU_LAYER_COUNT, &queries[0][0]);
+    supported = true;
+}
+
+// Read back one frame's queries if they are all done. A slot whose results
+// are still pending when it comes round again is dropped rather than waited on.
+static void collect(int slot) {
+    bool any = false;
+    for (int l = 0; l < GPU_LAYER_COUNT; ++l) {
+        if (!issued[slot][l]) continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[slot][l], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            dropped++;
+            for (int k = 0; k < GPU_LAYER_COUNT; ++k) issued[slot][k] = false;
+            return;
+        }
+        any = true;
+    }
+    if (!any) return;
+
+    float frame_ms = 0.0f;
+    for (int l = 0; l < GPU_LAYER_COUNT; ++l) {
+        if (!issued[slot][l]) continue;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[slot][l], GL_QUERY_RESULT, &ns);
+        float ms = ns / 1e6f;
+        layer_stats[l].add(ms);
+        frame_ms += ms;
+        issued[slot][l] = false;
+    }
+    frame_stats.add(frame_ms);
+}
+}
+
+void BeginGpuFrame() {
+    if (!initialized) init();
+    if (!supported) return;
+    frame_slot = (frame_slot + 1) % kQueryFrames;
+    collect(frame_slot);
+}
+
+void BeginGpuLayer(GpuLayer layer) {
+    if (!supported || !timing_enabled || active_layer >= 0) return;
+    glBeginQuery(GL_TIME_ELAPSED, queries[frame_slot][layer]);
+    active_layer = layer;
+}
+
+void EndGpuLayer() {
+    if (active_layer < 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    issued[frame_slot][active_layer] = true;
+    active_layer = -1;
+}
+
+void RenderGpuTimingControls() {
+    PROFILE_ZONE("RenderGpuTimingControls");
+    ImGui::Begin("GPU Timing");
+    bool enabled = timing_enabled;
+    if (ImGui::Checkbox("Time Stimulus Layers", &enabled)) timing_enabled = enabled;
+    ImGui::SameLine();
+    if (ImGui::Button("Reset Stats")) {
+        for (int l = 0; l < GPU_LAYER_COUNT; ++l) layer_stats[l].clear();
+        frame_stats.clear();
+    }
+    ImGui::Separator();
+    ImGui::Text("%-18s %8s %8s %8s %8s", "Layer (ms)", "p50", "p95", "p99", "max");
+    for (int l = 0; l < GPU_LAYER_COUNT; ++l) {
+        RollingStats::Summary s = layer_stats[l].summary();
+        ImGui::Text("%-18s %8.3f %8.3f %8.3f %8.3f", layer_names[l], s.p50, s.p95, s.p99, s.max);
+    }
+    RollingStats::Summary f = frame_stats.summary();
+    ImGui::Text("%-18s %8.3f %8.3f %8.3f %8.3f", "All Layers", f.p50, f.p95, f.p99, f.max);
+    ImGui::Text("Dropped (results late): %llu", (unsigned long long)dropped.load());
+    ImGui::End();
+}
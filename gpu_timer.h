@@ -0,0 +1,23 @@
+#pragma once
+
+// Stimulus layers timed on the GPU, in draw order
+enum GpuLayer {
+    GPU_LAYER_GRATINGS,
+    GPU_LAYER_CONCENTRIC_RINGS,
+    GPU_LAYER_SALESMAN,
+    GPU_LAYER_TRACKED_RINGS,
+    GPU_LAYER_CENTRAL_CIRCLE,
+    GPU_LAYER_CALIBRATION,
+    GPU_LAYER_WARP,
+    GPU_LAYER_COUNT
+};
+
+// Render thread, with the spotlight context current. Call BeginGpuFrame once
+// per frame before any layer; it also collects results from frames that
+// finished on the GPU a few frames ago, so nothing waits on the GPU. Layers
+// must not nest.
+void BeginGpuFrame();
+void BeginGpuLayer(GpuLayer layer);
+void EndGpuLayer();
+
+void RenderGpuTimingControls();
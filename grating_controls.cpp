@@ -1,46 +1,105 @@
 #include "grating_controls.h"
+#include "profiler.h"
 #include "imgui.h"
+#include "gl_shader.h"
 #include <algorithm>
 #include <cmath>
-#include <GL/gl.h>
 
 namespace {
-static bool show_grating = false;
-static int is_vertical = 1; 
-static float speed = 100.0f;
-static float bar_length = 40.0f; 
-static ImVec2 center = ImVec2(0.5f, 0.5f); 
-static float box_width = 0.3f; 
-static float box_height = 0.3f; 
-static ImVec4 bar_color = ImVec4(1,1,1,1);
-static ImVec4 bg_color = ImVec4(0,0,0,1);
+static GratingPatch patches[kMaxGratingPatches];
+static int patch_count = 1;
+static int selected_patch = 0;
+
+const char* kGratingVertexShader = R"(
+#version 130
+out vec2 v_pixel;
+void main() {
+    v_pixel = gl_Vertex.xy;
+    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;
 }
+)";
 
-void RenderGratingControls() {
-    ImGui::Begin("Grating Controls");
-    ImGui::Checkbox("Show Grating", &show_grating);
-    ImGui::RadioButton("Vertical Bars", &is_vertical, 1); ImGui::SameLine();
-    ImGui::RadioButton("Horizontal Bars", &is_vertical, 0);
-    ImGui::SliderFloat("Speed (px/s)", &speed, -500.0f, 500.0f, "%.1f");
-    ImGui::SliderFloat("Bar Length (px)", &bar_length, 5.0f, 200.0f, "%.1f");
-    ImGui::SliderFloat2("Center (norm)", (float*)&center, 0.0f, 1.0f);
-    ImGui::SliderFloat("Box Width (norm)", &box_width, 0.05f, 1.0f);
-    ImGui::SliderFloat("Box Height (norm)", &box_height, 0.05f, 1.0f);
-    ImGui::ColorEdit4("Bar Color", (float*)&bar_color);
-    ImGui::ColorEdit4("BG Color", (float*)&bg_color);
-    ImGui::End();
+const char* kGratingFragmentShader = R"(
+#version 130
+const float TWO_PI = 6.28318531;
+in vec2 v_pixel;
+uniform vec2 u_origin;      // box corner the phase is measured from
+uniform vec2 u_direction;   // unit grating normal
+uniform float u_offset;     // drift, already wrapped to one period
+uniform float u_bar_length;
+uniform int u_sinusoidal;
+uniform float u_contrast;
+uniform vec4 u_bar_color;
+uniform vec4 u_bg_color;
+void main() {
+    float period = 2.0 * u_bar_length;
+    float s = dot(v_pixel - u_origin, u_direction) - u_offset;
+    float f = mod(s, period);
+    float value;
+    if (u_sinusoidal != 0) {
+        value = 0.5 + 0.5 * cos(TWO_PI * (f - 0.5 * u_bar_length) / period);
+    } else {
+        // signed distance to the nearest bar edge, anti-aliased over a pixel
+        float inside = min(f, u_bar_length - f);
+        float outside = min(f - u_bar_length, period - f);
+        float d = f < u_bar_length ? inside : -outside;
+        value = clamp(d / max(fwidth(s), 1e-4) + 0.5, 0.0, 1.0);
+    }
+    vec4 mean = 0.5 * (u_bar_color + u_bg_color);
+    vec4 color = mix(u_bg_color, u_bar_color, value);
+    gl_FragColor = mean + u_contrast * (color - mean);
 }
+)";
+
+static bool shader_initialized = false;
+static GLuint program = 0;
+static GLint origin_loc, direction_loc, offset_loc, bar_length_loc;
+static GLint sinusoidal_loc, contrast_loc, bar_color_loc, bg_color_loc;
 
-void DrawMovingGratings(int width, int height, double time) {
-    if (!show_grating) return;
-    float cx = center.x * width;
-    float cy = center.y * height;
-    float w = box_width * width;
-    float h = box_height * height;
-    float left = cx - w/2, right = cx + w/2;
-    float top = cy - h/2, bottom = cy + h/2;
+static void init_shader() {
+    shader_initialized = true;
+    program = CompileShaderProgram("gratings", kGratingVertexShader, kGratingFragmentShader);
+    if (!program) return;
+    origin_loc = glGetUniformLocation(program, "u_origin");
+    direction_loc = glGetUniformLocation(program, "u_direction");
+    offset_loc = glGetUniformLocation(program, "u_offset");
+    bar_length_loc = glGetUniformLocation(program, "u_bar_length");
+    sinusoidal_loc = glGetUniformLocation(program, "u_sinusoidal");
+    contrast_loc = glGetUniformLocation(program, "u_contrast");
+    bar_color_loc = glGetUniformLocation(program, "u_bar_color");
+    bg_color_loc = glGetUniformLocation(program, "u_bg_color");
+}
 
-    glColor4f(bg_color.x, bg_color.y, bg_color.z, bg_color.w);
+// Keeps the part of a convex polygon where dot(p, direction) is on the
+// given side of bound. Returns the new vertex count.
+static int clip_half_plane(const ImVec2* in, int n, ImVec2 direction, float bound, bool keep_above, ImVec2* out) {
+    int m = 0;
+    for (int i = 0; i < n; ++i) {
+        const ImVec2& a = in[i];
+        const ImVec2& b = in[(i + 1) % n];
+        float da = (a.x * direction.x + a.y * direction.y - bound) * (keep_above ? 1.0f : -1.0f);
+        float db = (b.x * direction.x + b.y * direction.y - bound) * (keep_above ? 1.0f : -1.0f);
+        if (da >= 0.0f) out[m++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) {
+            float t = da / (da - db);
+            out[m++] = ImVec2(a.x + t * (b.x - a.x), a.y + t * (b.y - a.y));
+        }
+    }
+    return m;
+}
+
+// Immediate-mode stand-in for drivers without GLSL 130: square bars only,
+// no anti-aliasing, contrast applied to the two colors.
+static void draw_patch_fallback(const GratingPatch& p, float left, float top, float right, float bottom,
+                                ImVec2 direction, float offset) {
+    ImVec4 mean((p.bar_color.x + p.bg_color.x) * 0.5f, (p.bar_color.y + p.bg_color.y) * 0.5f,
+                (p.bar_color.z + p.bg_color.z) * 0.5f, (p.bar_color.w + p.bg_color.w) * 0.5f);
+    ImVec4 bar(mean.x + p.contrast * (p.bar_color.x - mean.x), mean.y + p.contrast * (p.bar_color.y - mean.y),
+               mean.z + p.contrast * (p.bar_color.z - mean.z), mean.w + p.contrast * (p.bar_color.w - mean.w));
+    ImVec4 bg(mean.x + p.contrast * (p.bg_color.x - mean.x), mean.y + p.contrast * (p.bg_color.y - mean.y),
+              mean.z + p.contrast * (p.bg_color.z - mean.z), mean.w + p.contrast * (p.bg_color.w - mean.w));
+
+    glColor4f(bg.x, bg.y, bg.z, bg.w);
     glBegin(GL_QUADS);
     glVertex3f(left, top, -1.0f);
     glVertex3f(right, top, -1.0f);
@@ -48,36 +107,120 @@ void DrawMovingGratings(int width, int height, double time) {
     glVertex3f(left, bottom, -1.0f);
     glEnd();
 
-    glColor4f(bar_color.x, bar_color.y, bar_color.z, bar_color.w);
-    float period = 2 * bar_length;
-    float offset = std::fmod(time * speed, period);
-    if (is_vertical == 1) {
-        for (float x = left - period; x < right + period; x += period) {
-            float bar_x = x + offset;
-            float bar_x2 = bar_x + bar_length;
-            if (bar_x2 < left || bar_x > right) continue;
-            float bx1 = std::max(bar_x, left);
-            float bx2 = std::min(bar_x2, right);
-            glBegin(GL_QUADS);
-            glVertex3f(bx1, top, -1.0f);
-            glVertex3f(bx2, top, -1.0f);
-            glVertex3f(bx2, bottom, -1.0f);
-            glVertex3f(bx1, bottom, -1.0f);
-            glEnd();
+    // Phase is measured from the top-left corner, as in the shader
+    const ImVec2 box[4] = { ImVec2(0, 0), ImVec2(right - left, 0), ImVec2(right - left, bottom - top),
+                            ImVec2(0, bottom - top) };
+    float s_min = 0.0f, s_max = 0.0f;
+    for (int i = 1; i < 4; ++i) {
+        float s = box[i].x * direction.x + box[i].y * direction.y;
+        s_min = std::min(s_min, s);
+        s_max = std::max(s_max, s);
+    }
+    float period = 2 * p.bar_length;
+    glColor4f(bar.x, bar.y, bar.z, bar.w);
+    for (float k = std::floor((s_min - offset) / period); k * period + offset < s_max; k += 1.0f) {
+        float start = k * period + offset;
+        ImVec2 half[5], clipped[6];
+        int n = clip_half_plane(box, 4, direction, start, true, half);
+        n = clip_half_plane(half, n, direction, start + p.bar_length, false, clipped);
+        if (n < 3) continue;
+        glBegin(GL_POLYGON);
+        for (int i = 0; i < n; ++i) glVertex3f(left + clipped[i].x, top + clipped[i].y, -1.0f);
+        glEnd();
+    }
+}
+}
+
+void RenderGratingControls() {
+    PROFILE_ZONE("RenderGratingControls");
+    ImGui::Begin("Grating Controls");
+    ImGui::SliderInt("Patch", &selected_patch, 0, patch_count - 1);
+    ImGui::SameLine();
+    if (ImGui::Button("Add Patch") && patch_count < kMaxGratingPatches) {
+        patches[patch_count] = patches[selected_patch];
+        selected_patch = patch_count++;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Remove Patch") && patch_count > 1) {
+        std::copy(patches + selected_patch + 1, patches + patch_count, patches + selected_patch);
+        patch_count--;
+        patches[patch_count] = GratingPatch();
+        selected_patch = std::min(selected_patch, patch_count - 1);
+    }
+
+    GratingPatch& p = patches[selected_patch];
+    ImGui::Checkbox("Show Grating", &p.show);
+    ImGui::SliderFloat("Orientation (deg)", &p.orientation_deg, 0.0f, 360.0f, "%.1f");
+    if (ImGui::Button("Vertical Bars")) p.orientation_deg = 0.0f;
+    ImGui::SameLine();
+    if (ImGui::Button("Horizontal Bars")) p.orientation_deg = 90.0f;
+    ImGui::RadioButton("Square", &p.sinusoidal, 0); ImGui::SameLine();
+    ImGui::RadioButton("Sine", &p.sinusoidal, 1);
+    ImGui::SliderFloat("Speed (px/s)", &p.speed, -500.0f, 500.0f, "%.1f");
+    ImGui::SliderFloat("Bar Length (px)", &p.bar_length, 1.0f, 200.0f, "%.1f");
+    ImGui::Text("Spatial frequency: %.4f cycles/px", 1.0f / (2.0f * p.bar_length));
+    ImGui::SliderFloat("Contrast", &p.contrast, 0.0f, 1.0f, "%.2f");
+    ImGui::SliderFloat2("Center (norm)", (float*)&p.center, 0.0f, 1.0f);
+    ImGui::SliderFloat("Box Width (norm)", &p.box_width, 0.05f, 1.0f);
+    ImGui::SliderFloat("Box Height (norm)", &p.box_height, 0.05f, 1.0f);
+    ImGui::ColorEdit4("Bar Color", (float*)&p.bar_color);
+    ImGui::ColorEdit4("BG Color", (float*)&p.bg_color);
+    if (shader_initialized && !program) {
+        ImGui::TextColored(ImVec4(1, 1, 0, 1), "Grating shader unavailable, drawing square bars without anti-aliasing");
+    }
+    ImGui::End();
+}
+
+GratingParams GetGratingParams() {
+    GratingParams params;
+    std::copy(patches, patches + kMaxGratingPatches, params.patches);
+    params.patch_count = patch_count;
+    return params;
+}
+
+void DrawMovingGratings(const GratingParams& params, int width, int height, double time) {
+    PROFILE_ZONE("DrawMovingGratings");
+    if (!shader_initialized) init_shader();
+
+    bool bound = false;
+    for (int i = 0; i < params.patch_count; ++i) {
+        const GratingPatch& p = params.patches[i];
+        if (!p.show) continue;
+        float cx = p.center.x * width;
+        float cy = p.center.y * height;
+        float w = p.box_width * width;
+        float h = p.box_height * height;
+        float left = cx - w/2, right = cx + w/2;
+        float top = cy - h/2, bottom = cy + h/2;
+
+        // wrap the drift in double precision so long sessions keep sub-pixel phase
+        float period = 2 * p.bar_length;
+        float offset = (float)std::fmod(time * p.speed, (double)period);
+        float angle = p.orientation_deg * 3.1415926f / 180.0f;
+        if (!program) {
+            draw_patch_fallback(p, left, top, right, bottom, ImVec2(std::cos(angle), std::sin(angle)), offset);
+            continue;
         }
-    } else {
-        for (float y = top - period; y < bottom + period; y += period) {
-            float bar_y = y + offset;
-            float bar_y2 = bar_y + bar_length;
-            if (bar_y2 < top || bar_y > bottom) continue;
-            float by1 = std::max(bar_y, top);
-            float by2 = std::min(bar_y2, bottom);
-            glBegin(GL_QUADS);
-            glVertex3f(left, by1, -1.0f);
-            glVertex3f(right, by1, -1.0f);
-            glVertex3f(right, by2, -1.0f);
-            glVertex3f(left, by2, -1.0f);
-            glEnd();
+        if (!bound) {
+            glUseProgram(program);
+            bound = true;
         }
+
+        glUniform2f(origin_loc, left, top);
+        glUniform2f(direction_loc, std::cos(angle), std::sin(angle));
+        glUniform1f(offset_loc, offset);
+        glUniform1f(bar_length_loc, p.bar_length);
+        glUniform1i(sinusoidal_loc, p.sinusoidal);
+        glUniform1f(contrast_loc, p.contrast);
+        glUniform4f(bar_color_loc, p.bar_color.x, p.bar_color.y, p.bar_color.z, p.bar_color.w);
+        glUniform4f(bg_color_loc, p.bg_color.x, p.bg_color.y, p.bg_color.z, p.bg_color.w);
+
+        glBegin(GL_QUADS);
+        glVertex3f(left, top, -1.0f);
+        glVertex3f(right, top, -1.0f);
+        glVertex3f(right, bottom, -1.0f);
+        glVertex3f(left, bottom, -1.0f);
+        glEnd();
     }
+    if (bound) glUseProgram(0);
 }
@@ -1,5 +1,29 @@
 #pragma once
 #include "imgui.h"
 
+// Bars are bar_length wide with an equal gap and drift along the grating
+// normal. Orientation 0 gives vertical bars, 90 horizontal bars.
+struct GratingPatch {
+    bool show = false;
+    float orientation_deg = 0.0f;
+    int sinusoidal = 0;
+    float speed = 100.0f;
+    float bar_length = 40.0f;
+    float contrast = 1.0f;
+    ImVec2 center = ImVec2(0.5f, 0.5f);
+    float box_width = 0.3f;
+    float box_height = 0.3f;
+    ImVec4 bar_color = ImVec4(1,1,1,1);
+    ImVec4 bg_color = ImVec4(0,0,0,1);
+};
+
+const int kMaxGratingPatches = 8;
+
+struct GratingParams {
+    GratingPatch patches[kMaxGratingPatches];
+    int patch_count;
+};
+
 void RenderGratingControls();
-void DrawMovingGratings(int width, int height, double time);
\ No newline at end of file
+GratingParams GetGratingParams();
+void DrawMovingGratings(const GratingParams& params, int width, int height, double time);
@@ -0,0 +1,209 @@
+#include "latency_stats.h"
+#include "profiler.h"
+#include "frame_pacing.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+RollingStats::RollingStats(int capacity)
+    : samples_(capacity, 0.0f), next_(0), count_(0), scratch_(capacity, 0.0f) {}
+
+void RollingStats::add(float value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    samples_[next_] = value;
+    next_ = (next_ + 1) % (int)samples_.size();
+    count_ = std::min(count_ + 1, (int)samples_.size());
+}
+
+void RollingStats::add(const float* values, int count) {
+    if (count <= 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    int size = (int)samples_.size();
+    if (count > size) {
+        values += count - size;  // the older ones would be overwritten anyway
+        count = size;
+    }
+    for (int i = 0; i < count; ++i) {
+        samples_[next_] = values[i];
+        next_ = next_ + 1 == size ? 0 : next_ + 1;
+    }
+    count_ = std::min(count_ + count, size);
+}
+
+void RollingStats::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    next_ = 0;
+    count_ = 0;
+}
+
+RollingStats::Summary RollingStats::summary() const {
+    int n;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        n = count_;
+        std::copy(samples_.begin(), samples_.begin() + n, scratch_.begin());
+    }
+    Summary s = {n, 0.0f, 0.0f, 0.0f, 0.0f};
+    if (n == 0) return s;
+    std::sort(scratch_.begin(), scratch_.begin() + n);
+    s.p50 = scratch_[(n - 1) * 50 / 100];
+    s.p95 = scratch_[(n - 1) * 95 / 100];
+    s.p99 = scratch_[(n - 1) * 99 / 100];
+    s.max = scratch_[n - 1];
+    return s;
+}
+
+namespace {
+enum Stage { TRACKER, HANDOFF, RENDER, SWAP, TOTAL, STAGE_COUNT };
+static const char* stage_names[STAGE_COUNT] = {
+    "Tracker -> Reader", "Reader -> Render", "Draw Submit", "Swap", "Motion to Photon"
+};
+static RollingStats stage_stats[STAGE_COUNT];
+
+// Motion to photon and input age at swap, by frame pacing mode
+static RollingStats pacing_total[PACING_MODE_COUNT];
+static RollingStats pacing_input_age[PACING_MODE_COUNT];
+
+// Render cost by object count decade: 0, 1-9, 10-99, ... 10000+
+const int kScaleBuckets = 6;
+static const char* bucket_names[kScaleBuckets] = { "0", "1+", "10+", "100+", "1000+", "10000+" };
+static RollingStats bucket_submit[kScaleBuckets];
+static RollingStats bucket_interval[kScaleBuckets];
+static uint64_t last_swapped_us = 0;
+
+static int scale_bucket(int objects) {
+    int b = 0;
+    for (int n = objects; n > 0 && b < kScaleBuckets - 1; n /= 10) ++b;
+    return b;
+}
+
+static bool log_enabled = false;
+static std::mutex log_mutex;  // toggled from the UI, written by the render thread
+static FILE* log_file = nullptr;
+static char log_buffer[1 << 16];
+
+static void open_log() {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    char name[64];
+    std::time_t t = std::time(nullptr);
+    std::strftime(name, sizeof(name), "latency_%Y%m%d_%H%M%S.csv", std::localtime(&t));
+    log_file = std::fopen(name, "w");
+    if (!log_file) {
+        std::perror("failed to open latency log");
+        log_enabled = false;
+        return;
+    }
+    std::setvbuf(log_file, log_buffer, _IOFBF, sizeof(log_buffer));
+    std::fprintf(log_file, "sequence,objects,writer_us,received_us,consumed_us,submitted_us,swapped_us,pacing\n");
+}
+
+static void close_log() {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (log_file) {
+        std::fclose(log_file);
+        log_file = nullptr;
+    }
+}
+
+static float ms(uint64_t from, uint64_t to) {
+    return to > from ? (to - from) / 1000.0f : 0.0f;
+}
+
+static void write_scaling_report() {
+    char name[64];
+    std::time_t t = std::time(nullptr);
+    std::strftime(name, sizeof(name), "scaling_report_%Y%m%d_%H%M%S.csv", std::localtime(&t));
+    FILE* f = std::fopen(name, "w");
+    if (!f) {
+        std::perror("failed to write scaling report");
+        return;
+    }
+    std::fprintf(f, "objects,frames,submit_p50_ms,submit_p95_ms,submit_p99_ms,frame_p50_ms,frame_p99_ms,fps\n");
+    for (int b = 0; b < kScaleBuckets; ++b) {
+        RollingStats::Summary s = bucket_submit[b].summary();
+        RollingStats::Summary i = bucket_interval[b].summary();
+        if (s.count == 0) continue;
+        std::fprintf(f, "%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f\n", bucket_names[b], s.count,
+                     s.p50, s.p95, s.p99, i.p50, i.p99, i.p50 > 0.0f ? 1000.0f / i.p50 : 0.0f);
+    }
+    std::fclose(f);
+    std::printf("wrote %s\n", name);
+}
+}
+
+void RecordFrameTiming(const FrameTiming& t) {
+    if (t.sequence != 0) {
+        stage_stats[TRACKER].add(ms(t.writer_us, t.received_us));
+        stage_stats[HANDOFF].add(ms(t.received_us, t.consumed_us));
+        stage_stats[TOTAL].add(ms(t.writer_us, t.swapped_us));
+    }
+    if (t.pacing >= 0 && t.pacing < PACING_MODE_COUNT) {
+        if (t.sequence != 0) pacing_total[t.pacing].add(ms(t.writer_us, t.swapped_us));
+        pacing_input_age[t.pacing].add(ms(t.consumed_us, t.swapped_us));
+    }
+    stage_stats[RENDER].add(ms(t.consumed_us, t.submitted_us));
+    stage_stats[SWAP].add(ms(t.submitted_us, t.swapped_us));
+
+    int b = scale_bucket(t.objects);
+    bucket_submit[b].add(ms(t.consumed_us, t.submitted_us));
+    if (last_swapped_us != 0) bucket_interval[b].add(ms(last_swapped_us, t.swapped_us));
+    last_swapped_us = t.swapped_us;
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (log_file) {
+        std::fprintf(log_file, "%llu,%d,%llu,%llu,%llu,%llu,%llu,%s\n",
+                     (unsigned long long)t.sequence, t.objects,
+                     (unsigned long long)t.writer_us, (unsigned long long)t.received_us,
+                     (unsigned long long)t.consumed_us, (unsigned long long)t.submitted_us,
+                     (unsigned long long)t.swapped_us, kFramePacingModeNames[t.pacing]);
+    }
+}
+
+void RenderLatencyControls() {
+    PROFILE_ZONE("RenderLatencyControls");
+    ImGui::Begin("Latency");
+    if (ImGui::Checkbox("Log to CSV", &log_enabled)) {
+        if (log_enabled) open_log(); else close_log();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset Stats")) {
+        for (int i = 0; i < STAGE_COUNT; ++i) stage_stats[i].clear();
+        for (int m = 0; m < PACING_MODE_COUNT; ++m) {
+            pacing_total[m].clear();
+            pacing_input_age[m].clear();
+        }
+        for (int b = 0; b < kScaleBuckets; ++b) {
+            bucket_submit[b].clear();
+            bucket_interval[b].clear();
+        }
+    }
+    ImGui::Separator();
+    ImGui::Text("%-18s %8s %8s %8s %8s", "Stage (ms)", "p50", "p95", "p99", "max");
+    for (int i = 0; i < STAGE_COUNT; ++i) {
+        RollingStats::Summary s = stage_stats[i].summary();
+        ImGui::Text("%-18s %8.2f %8.2f %8.2f %8.2f", stage_names[i], s.p50, s.p95, s.p99, s.max);
+    }
+    ImGui::Separator();
+    ImGui::Text("%-14s %8s %12s %12s %12s", "Pacing", "Frames", "M2P p50", "M2P p99", "Input age");
+    for (int m = 0; m < PACING_MODE_COUNT; ++m) {
+        RollingStats::Summary a = pacing_input_age[m].summary();
+        if (a.count == 0) continue;
+        RollingStats::Summary total = pacing_total[m].summary();
+        ImGui::Text("%-14s %8d %12.2f %12.2f %12.2f", kFramePacingModeNames[m], a.count,
+                    total.p50, total.p99, a.p50);
+    }
+    ImGui::Separator();
+    ImGui::Text("%-8s %8s %10s %10s %8s", "Objects", "Frames", "Submit p50", "Submit p99", "FPS");
+    for (int b = 0; b < kScaleBuckets; ++b) {
+        RollingStats::Summary s = bucket_submit[b].summary();
+        if (s.count == 0) continue;
+        RollingStats::Summary i = bucket_interval[b].summary();
+        ImGui::Text("%-8s %8d %10.2f %10.2f %8.1f", bucket_names[b], s.count, s.p50, s.p99,
+                    i.p50 > 0.0f ? 1000.0f / i.p50 : 0.0f);
+    }
+    if (ImGui::Button("Write Scaling Report")) {
+        write_scaling_report();
+    }
+    ImGui::End();
+}
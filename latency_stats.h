@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Fixed-size window of recent samples with a percentile summary. add() may
+// be called from any thread; summary() is meant for the UI thread.
+class RollingStats {
+public:
+    explicit RollingStats(int capacity = 1024);
+
+    void add(float value);
+    void add(const float* values, int count);  // one lock for the lot
+    void clear();
+
+    struct Summary {
+        int count;
+        float p50, p95, p99, max;
+    };
+    Summary summary() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<float> samples_;
+    int next_;
+    int count_;
+    mutable std::vector<float> scratch_;
+};
+
+// Timestamps (get_time_us clock) for one displayed spotlight frame
+struct FrameTiming {
+    uint64_t sequence;      // tracker frame shown, 0 if none yet
+    uint64_t writer_us;     // tracker wrote the boxes
+    uint64_t received_us;   // reader thread popped them
+    uint64_t consumed_us;   // render loop picked them up
+    uint64_t submitted_us;  // all draw calls issued
+    uint64_t swapped_us;    // glfwSwapBuffers returned
+    int objects;
+    int pacing;             // FramePacingMode the frame was rendered with
+};
+
+void RecordFrameTiming(const FrameTiming& timing);
+void RenderLatencyControls();
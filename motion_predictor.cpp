@@ -0,0 +1,211 @@
+#include "motion_predictor.h"
+#include "profiler.h"
+#include "latency_stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// Set from the UI, read by the render thread
+static std::atomic<bool> prediction_enabled{false};
+static std::atomic<float> lookahead_ms{0.0f};       // on top of the measured present delay
+static std::atomic<float> max_horizon_ms{100.0f};
+static std::atomic<uint64_t> present_delay_us{8000};
+
+static uint64_t last_sequence = 0;
+
+static ImVec2 raw_centers[kMaxFrameObjects];
+static ImVec2 predicted_centers[kMaxFrameObjects];
+
+static RollingStats predicted_error;
+static RollingStats unpredicted_error;
+
+// This frame's errors, added to the rolling stats in one batch each
+static float frame_predicted_error[kMaxFrameObjects];
+static float frame_unpredicted_error[kMaxFrameObjects];
+
+// The CSV is written by a log thread; the render thread only appends a
+// frame's records to log_pending under one lock. log_pending is reserved
+// when the log opens and only grows while the writer is behind.
+struct ErrorRecord {
+    uint64_t sequence;
+    uint64_t writer_us;
+    uint32_t track_id;
+    float predicted_err_px;
+    float unpredicted_err_px;
+};
+const size_t kMaxPendingRecords = 1 << 20;  // frames beyond this are dropped, not queued
+
+static bool log_enabled = false;       // UI thread
+static std::atomic<bool> logging{false};
+static std::mutex log_mutex;           // guards log_pending, log_running and log_dropped
+static std::condition_variable log_ready;
+static std::vector<ErrorRecord> log_pending;
+static bool log_running = false;
+static uint64_t log_dropped = 0;       // frames
+static std::thread log_thread;
+static char log_buffer[1 << 16];
+
+static void log_loop(FILE* file) {
+    std::vector<ErrorRecord> batch;
+    batch.reserve(kMaxFrameObjects);
+    bool running = true;
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(log_mutex);
+            log_ready.wait(lock, [] { return !log_pending.empty() || !log_running; });
+            batch.swap(log_pending);
+            running = log_running;
+        }
+        for (const ErrorRecord& r : batch) {
+            std::fprintf(file, "%llu,%llu,%u,%.2f,%.2f\n", (unsigned long long)r.sequence,
+                         (unsigned long long)r.writer_us, r.track_id, r.predicted_err_px, r.unpredicted_err_px);
+        }
+        batch.clear();
+    }
+    std::fclose(file);
+}
+
+static void open_log() {
+    char name[64];
+    std::time_t t = std::time(nullptr);
+    std::strftime(name, sizeof(name), "prediction_%Y%m%d_%H%M%S.csv", std::localtime(&t));
+    FILE* file = std::fopen(name, "w");
+    if (!file) {
+        std::perror("failed to open prediction log");
+        log_enabled = false;
+        return;
+    }
+    std::setvbuf(file, log_buffer, _IOFBF, sizeof(log_buffer));
+    std::fprintf(file, "sequence,writer_us,track_id,predicted_err_px,unpredicted_err_px\n");
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        log_pending.clear();
+        log_pending.reserve(kMaxFrameObjects * 4);
+        log_running = true;
+        log_dropped = 0;
+    }
+    log_thread = std::thread(log_loop, file);
+    logging = true;
+}
+
+static void close_log() {
+    if (!log_thread.joinable()) return;
+    logging = false;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        log_running = false;
+    }
+    log_ready.notify_one();
+    log_thread.join();  // writes what is pending first
+}
+
+// A log still open at exit is flushed; a joinable thread would terminate
+struct LogCloser {
+    ~LogCloser() { close_log(); }
+};
+static LogCloser log_closer;
+
+// Error of the track's prediction at each new observation, against the
+// no-prediction baseline of using the last observed position. This is the
+// tracker's one-frame innovation, a proxy for the error at the lookahead
+// horizon rather than that error itself.
+static void record_errors(const BoxFrame& frame) {
+    int matched = 0;
+    for (int i = 0; i < frame.count; ++i) {
+        const TrackedObject& t = frame.tracked[i];
+        raw_centers[i] = ImVec2(t.x, t.y);
+        if (!t.matched) continue;
+        frame_predicted_error[matched] = t.innovation;
+        frame_unpredicted_error[matched] = t.displacement;
+        matched++;
+    }
+    predicted_error.add(frame_predicted_error, matched);
+    unpredicted_error.add(frame_unpredicted_error, matched);
+    last_sequence = frame.sequence;
+
+    if (!logging.load(std::memory_order_relaxed) || matched == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        if (!log_running) return;
+        if (log_pending.size() + matched > kMaxPendingRecords) {
+            log_dropped++;
+            return;
+        }
+        for (int i = 0; i < frame.count; ++i) {
+            const TrackedObject& t = frame.tracked[i];
+            if (!t.matched) continue;
+            ErrorRecord r = { frame.sequence, frame.writer_timestamp, t.id, t.innovation, t.displacement };
+            log_pending.push_back(r);
+        }
+    }
+    log_ready.notify_one();
+}
+}
+
+const ImVec2* PredictBoxCenters(const BoxFrame& frame, uint64_t present_us) {
+    if (frame.sequence != last_sequence) {
+        record_errors(frame);
+    }
+    if (!prediction_enabled) return raw_centers;
+
+    float horizon = present_us > frame.writer_timestamp ? (present_us - frame.writer_timestamp) / 1e6f : 0.0f;
+    horizon = std::min(horizon, max_horizon_ms / 1000.0f);
+    for (int i = 0; i < frame.count; ++i) {
+        predicted_centers[i].x = raw_centers[i].x + frame.tracked[i].vx * horizon;
+        predicted_centers[i].y = raw_centers[i].y + frame.tracked[i].vy * horizon;
+    }
+    return predicted_centers;
+}
+
+void ObservePresentDelay(uint64_t delay_us) {
+    present_delay_us = (present_delay_us * 15 + delay_us) / 16;
+}
+
+uint64_t GetPredictedPresentTime(uint64_t consumed_us) {
+    int64_t offset = (int64_t)present_delay_us + (int64_t)(lookahead_ms * 1000.0f);
+    return (uint64_t)std::max<int64_t>(0, (int64_t)consumed_us + offset);
+}
+
+void RenderMotionPredictionControls() {
+    PROFILE_ZONE("RenderMotionPredictionControls");
+    ImGui::Begin("Motion Prediction");
+    bool enabled = prediction_enabled;
+    if (ImGui::Checkbox("Enable Prediction", &enabled)) prediction_enabled = enabled;
+    float lookahead = lookahead_ms;
+    if (ImGui::SliderFloat("Extra Lookahead (ms)", &lookahead, -20.0f, 50.0f, "%.1f")) lookahead_ms = lookahead;
+    float horizon = max_horizon_ms;
+    if (ImGui::SliderFloat("Max Horizon (ms)", &horizon, 0.0f, 200.0f, "%.0f")) max_horizon_ms = horizon;
+    ImGui::Text("Measured present delay: %.2f ms", present_delay_us / 1000.0);
+    ImGui::Separator();
+    if (ImGui::Checkbox("Log Errors to CSV", &log_enabled)) {
+        if (log_enabled) open_log(); else close_log();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset Errors")) {
+        predicted_error.clear();
+        unpredicted_error.clear();
+    }
+    RollingStats::Summary p = predicted_error.summary();
+    RollingStats::Summary u = unpredicted_error.summary();
+    ImGui::Text("%-14s %7s %7s %7s", "Error (px)", "p50", "p95", "p99");
+    ImGui::Text("%-14s %7.1f %7.1f %7.1f", "Predicted", p.p50, p.p95, p.p99);
+    ImGui::Text("%-14s %7.1f %7.1f %7.1f", "Last position", u.p50, u.p95, u.p99);
+    ImGui::TextWrapped("One frame ahead: the tracker's innovation, a proxy for the error at the lookahead "
+                       "horizon, which grows with the horizon.");
+    if (log_enabled) {
+        uint64_t dropped;
+        {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            dropped = log_dropped;
+        }
+        if (dropped > 0) ImGui::TextColored(ImVec4(1, 0, 0, 1), "CSV log fell behind, %llu frames dropped",
+                                            (unsigned long long)dropped);
+    }
+    ImGui::End();
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "imgui.h"
+#include "box_reader.h"
+#include <cstdint>
+
+// Camera-space centers for every box in the frame, extrapolated to
+// present_us when prediction is enabled. Render thread only; the array
+// holds frame.count entries and is valid until the next call.
+const ImVec2* PredictBoxCenters(const BoxFrame& frame, uint64_t present_us);
+
+// Time from picking up a frame to the swap that shows it
+void ObservePresentDelay(uint64_t delay_us);
+uint64_t GetPredictedPresentTime(uint64_t consumed_us);
+
+void RenderMotionPredictionControls();
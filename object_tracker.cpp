@@ -0,0 +1,250 @@
+#include "object_tracker.h"
+#include "profiler.h"
+#include "box_reader.h"
+#include "latency_stats.h"
+#include "imgui.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+namespace {
+const int kMaxTracks = 2 * kMaxFrameObjects;  // room for coasting tracks
+const int kGridBuckets = 16384;               // power of two
+const int kMaxCandidates = 4;                 // nearest detections kept per track
+
+static std::atomic<float> gate_px{60.0f};
+static std::atomic<int> max_coast_frames{10};
+static std::atomic<float> velocity_smoothing{0.5f};
+
+struct Track {
+    uint32_t id;
+    float x, y;         // last observed center
+    float vx, vy;
+    uint64_t seen_us;   // time of the last observation
+    int misses;
+};
+static Track tracks[kMaxTracks];
+static bool track_matched[kMaxTracks];
+static int track_count = 0;
+static uint32_t next_id = 1;
+
+// uniform grid over the detections, cell size = gate
+static int bucket_head[kGridBuckets];
+static int det_next[kMaxFrameObjects];
+static int det_track[kMaxFrameObjects];
+static int det_best_track[kMaxFrameObjects];
+static float det_best_d_sq[kMaxFrameObjects];
+
+struct Pair {
+    float d_sq;
+    int track;
+    int det;
+};
+static Pair pairs[kMaxTracks * kMaxCandidates];
+static int track_first_pair[kMaxTracks];
+static int track_pair_count[kMaxTracks];
+
+static std::atomic<uint64_t> births{0};
+static std::atomic<uint64_t> deaths{0};
+static std::atomic<int> active_tracks{0};
+static std::atomic<int> coasting_tracks{0};
+static std::atomic<int> last_detections{0};
+static RollingStats update_cost_us(512);
+
+static inline unsigned cell_hash(int cx, int cy) {
+    return ((unsigned)cx * 73856093u ^ (unsigned)cy * 19349663u) & (kGridBuckets - 1);
+}
+
+static inline float center_x(const shaman::Object& obj) { return obj.rect.x + obj.rect.width * 0.5f; }
+static inline float center_y(const shaman::Object& obj) { return obj.rect.y - obj.rect.height * 0.5f; }
+}
+
+void UpdateObjectTracks(const shaman::Object* objects, int count, uint64_t timestamp_us, TrackedObject* out) {
+    auto start = std::chrono::steady_clock::now();
+
+    const float gate = gate_px.load(std::memory_order_relaxed);
+    const float gate_sq = gate * gate;
+    const float smoothing = velocity_smoothing.load(std::memory_order_relaxed);
+    const int max_coast = max_coast_frames.load(std::memory_order_relaxed);
+    count = std::min(count, kMaxFrameObjects);
+
+    // Bucket the detections
+    std::fill(bucket_head, bucket_head + kGridBuckets, -1);
+    for (int i = 0; i < count; ++i) {
+        int cx = (int)std::floor(center_x(objects[i]) / gate);
+        int cy = (int)std::floor(center_y(objects[i]) / gate);
+        unsigned h = cell_hash(cx, cy);
+        det_next[i] = bucket_head[h];
+        bucket_head[h] = i;
+        det_track[i] = -1;
+        det_best_track[i] = -1;
+        det_best_d_sq[i] = gate_sq;
+    }
+
+    // Gather the nearest detections around each track's predicted position
+    int pair_count = 0;
+    for (int t = 0; t < track_count; ++t) {
+        track_matched[t] = false;
+        float dt = timestamp_us > tracks[t].seen_us ? (timestamp_us - tracks[t].seen_us) / 1e6f : 0.0f;
+        float px = tracks[t].x + tracks[t].vx * dt;
+        float py = tracks[t].y + tracks[t].vy * dt;
+        int cx = (int)std::floor(px / gate);
+        int cy = (int)std::floor(py / gate);
+
+        Pair* local = pairs + pair_count;
+        int n = 0;
+        for (int gy = cy - 1; gy <= cy + 1; ++gy) {
+            for (int gx = cx - 1; gx <= cx + 1; ++gx) {
+                for (int i = bucket_head[cell_hash(gx, gy)]; i >= 0; i = det_next[i]) {
+                    float dx = center_x(objects[i]) - px;
+                    float dy = center_y(objects[i]) - py;
+                    float d_sq = dx * dx + dy * dy;
+                    if (d_sq >= gate_sq) continue;
+                    bool seen = false;
+                    for (int k = 0; k < n; ++k) seen |= local[k].det == i;
+                    if (seen) continue;  // hash collision between neighbouring cells
+                    if (n == kMaxCandidates) {
+                        if (d_sq >= local[n - 1].d_sq) continue;
+                        --n;
+                    }
+                    int k = n++;
+                    while (k > 0 && local[k - 1].d_sq > d_sq) {
+                        local[k] = local[k - 1];
+                        --k;
+                    }
+                    local[k].d_sq = d_sq;
+                    local[k].track = t;
+                    local[k].det = i;
+                }
+            }
+        }
+        for (int k = 0; k < n; ++k) {
+            if (local[k].d_sq < det_best_d_sq[local[k].det]) {
+                det_best_d_sq[local[k].det] = local[k].d_sq;
+                det_best_track[local[k].det] = t;
+            }
+        }
+        track_first_pair[t] = pair_count;
+        track_pair_count[t] = n;
+        pair_count += n;
+    }
+
+    // Mutual nearest neighbours are what the greedy pass would pick anyway;
+    // take them directly so only contested pairs need sorting
+    for (int t = 0; t < track_count; ++t) {
+        if (track_pair_count[t] == 0) continue;
+        int det = pairs[track_first_pair[t]].det;
+        if (det_best_track[det] == t) {
+            track_matched[t] = true;
+            det_track[det] = t;
+        }
+    }
+    int contested = 0;
+    for (int p = 0; p < pair_count; ++p) {
+        if (!track_matched[pairs[p].track] && det_track[pairs[p].det] < 0) pairs[contested++] = pairs[p];
+    }
+    pair_count = contested;
+
+    // Greedy assignment of the rest, globally closest pairs first
+    std::sort(pairs, pairs + pair_count, [](const Pair& a, const Pair& b) { return a.d_sq < b.d_sq; });
+    for (int p = 0; p < pair_count; ++p) {
+        if (track_matched[pairs[p].track] || det_track[pairs[p].det] >= 0) continue;
+        track_matched[pairs[p].track] = true;
+        det_track[pairs[p].det] = pairs[p].track;
+    }
+
+    // Continue matched tracks
+    for (int i = 0; i < count; ++i) {
+        int t = det_track[i];
+        if (t < 0) continue;
+        Track& track = tracks[t];
+        float x = center_x(objects[i]);
+        float y = center_y(objects[i]);
+        float dt = timestamp_us > track.seen_us ? (timestamp_us - track.seen_us) / 1e6f : 1e-3f;
+        float px = track.x + track.vx * dt;
+        float py = track.y + track.vy * dt;
+
+        TrackedObject& o = out[i];
+        o.id = track.id;
+        o.x = x;
+        o.y = y;
+        o.matched = true;
+        o.innovation = std::sqrt((x - px) * (x - px) + (y - py) * (y - py));
+        o.displacement = std::sqrt((x - track.x) * (x - track.x) + (y - track.y) * (y - track.y));
+
+        track.vx = smoothing * track.vx + (1.0f - smoothing) * (x - track.x) / dt;
+        track.vy = smoothing * track.vy + (1.0f - smoothing) * (y - track.y) / dt;
+        track.x = x;
+        track.y = y;
+        track.seen_us = timestamp_us;
+        track.misses = 0;
+        o.vx = track.vx;
+        o.vy = track.vy;
+    }
+
+    // Coast unmatched tracks through short occlusions, drop the rest
+    int kept = 0;
+    int coasting = 0;
+    for (int t = 0; t < track_count; ++t) {
+        Track track = tracks[t];
+        if (!track_matched[t]) {
+            if (++track.misses > max_coast) {
+                deaths++;
+                continue;
+            }
+            coasting++;
+        }
+        tracks[kept++] = track;
+    }
+    track_count = kept;
+
+    // Births
+    for (int i = 0; i < count; ++i) {
+        if (det_track[i] >= 0) continue;
+        TrackedObject& o = out[i];
+        o.id = next_id++;
+        o.x = center_x(objects[i]);
+        o.y = center_y(objects[i]);
+        o.vx = o.vy = 0.0f;
+        o.matched = false;
+        o.innovation = 0.0f;
+        o.displacement = 0.0f;
+        births++;
+        if (track_count < kMaxTracks) {
+            Track& track = tracks[track_count++];
+            track.id = o.id;
+            track.x = o.x;
+            track.y = o.y;
+            track.vx = track.vy = 0.0f;
+            track.seen_us = timestamp_us;
+            track.misses = 0;
+        }
+    }
+
+    active_tracks = track_count;
+    coasting_tracks = coasting;
+    last_detections = count;
+    update_cost_us.add(std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count());
+}
+
+void RenderObjectTrackerControls() {
+    PROFILE_ZONE("RenderObjectTrackerControls");
+    ImGui::Begin("Object Tracker");
+    float gate = gate_px;
+    int coast = max_coast_frames;
+    float smoothing = velocity_smoothing;
+    ImGui::SliderFloat("Match Gate (px)", &gate, 5.0f, 300.0f, "%.0f");
+    ImGui::SliderInt("Max Coast Frames", &coast, 0, 60);
+    ImGui::SliderFloat("Velocity Smoothing", &smoothing, 0.0f, 0.95f);
+    gate_px = gate;
+    max_coast_frames = coast;
+    velocity_smoothing = smoothing;
+    ImGui::Separator();
+    ImGui::Text("Detections: %d", last_detections.load());
+    ImGui::Text("Tracks: %d (%d coasting)", active_tracks.load(), coasting_tracks.load());
+    ImGui::Text("Births: %llu  Deaths: %llu", (unsigned long long)births.load(), (unsigned long long)deaths.load());
+    RollingStats::Summary s = update_cost_us.summary();
+    ImGui::Text("Update cost (us): p50 %.1f  p99 %.1f  max %.1f", s.p50, s.p99, s.max);
+    ImGui::End();
+}
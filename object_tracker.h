@@ -0,0 +1,22 @@
+#pragma once
+#include "shaman/shaman.h"
+#include <cstdint>
+
+// Per-detection association result, parallel to the frame's objects
+struct TrackedObject {
+    uint32_t id;         // stable across frames, never reused
+    float x, y;          // observed camera-space center
+    float vx, vy;        // smoothed velocity, camera px per second
+    bool matched;        // continued an existing track (false on birth)
+    float innovation;    // distance from the track's predicted position, px
+    float displacement;  // distance from the track's last position, px
+};
+
+// Greedy nearest-neighbour association with gating. Unmatched detections
+// start new tracks; unmatched tracks coast on their velocity for a few
+// frames so short occlusions keep their id. Candidate pairs come from a
+// uniform grid, so one update costs O(n log n) in the number of nearby
+// pairs rather than O(tracks * detections). Reader thread only.
+void UpdateObjectTracks(const shaman::Object* objects, int count, uint64_t timestamp_us, TrackedObject* out);
+
+void RenderObjectTrackerControls();
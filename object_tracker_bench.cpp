@@ -0,0 +1,162 @@
+// Microbenchmark for the object tracker's per-frame association.
+//
+//   object_tracker_bench [--objects 10,100,1000,10000] [--frames 2000]
+//                        [--dropout 0.02] [--turnover 0.005] [--seed 1]
+//
+// Moves synthetic objects across a 2048 x 2048 camera at 100 Hz. Each frame
+// every object is missed with probability --dropout, and with probability
+// --turnover it leaves and a new one appears elsewhere, so the tracker sees
+// coasting, deaths and births as well as plain continuations. Detections
+// arrive in a different order every frame. Prints the cost per update and
+// how often a continuing object changed id.
+#include "object_tracker.h"
+#include "box_reader.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <time.h>
+
+namespace {
+const float kSize = 2048.0f;
+const uint64_t kFrameUs = 10000;  // 100 Hz
+const int kWarmupFrames = 50;
+const int kDrainFrames = 64;      // longer than any coast, so counts start clean
+
+struct SimObject {
+    float x, y, vx, vy;
+    uint32_t last_id;  // tracker id when last seen, 0 before the first sighting
+};
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+std::vector<int> parse_counts(const char* s) {
+    std::vector<int> counts;
+    while (*s) {
+        counts.push_back(atoi(s));
+        const char* comma = strchr(s, ',');
+        if (!comma) break;
+        s = comma + 1;
+    }
+    return counts;
+}
+
+void spawn(SimObject& o, std::mt19937& rng) {
+    std::uniform_real_distribution<float> coord(0.0f, kSize);
+    std::uniform_real_distribution<float> speed(-300.0f, 300.0f);  // px/s
+    o.x = coord(rng);
+    o.y = coord(rng);
+    o.vx = speed(rng);
+    o.vy = speed(rng);
+    o.last_id = 0;
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {10, 100, 1000, 10000};
+    int frames = 2000;
+    double dropout = 0.02;
+    double turnover = 0.005;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--objects") && i + 1 < argc) {
+            counts = parse_counts(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dropout") && i + 1 < argc) {
+            dropout = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--turnover") && i + 1 < argc) {
+            turnover = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = (unsigned)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--objects 10,100,1000,10000] [--frames 2000] [--dropout 0.02] "
+                            "[--turnover 0.005] [--seed 1]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 1) {
+        fprintf(stderr, "--frames must be at least 1\n");
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::vector<shaman::Object> objects(kMaxFrameObjects);
+    std::vector<TrackedObject> tracked(kMaxFrameObjects);
+    std::vector<int> order;
+    uint64_t timestamp_us = 1;
+
+    printf("%8s %8s %10s %10s %10s %10s %10s\n", "objects", "frames", "p50 us", "p99 us", "max us", "ns/object",
+           "id switch");
+    for (int n : counts) {
+        n = std::min(n, kMaxFrameObjects);
+        std::vector<SimObject> sim(n);
+        for (SimObject& o : sim) spawn(o, rng);
+
+        for (int f = 0; f < kDrainFrames; ++f) {
+            timestamp_us += kFrameUs;
+            UpdateObjectTracks(objects.data(), 0, timestamp_us, tracked.data());
+        }
+
+        std::vector<double> cost_us;
+        uint64_t total_ns = 0, detections = 0, continued = 0, switches = 0;
+        for (int f = 0; f < kWarmupFrames + frames; ++f) {
+            timestamp_us += kFrameUs;
+            float dt = kFrameUs / 1e6f;
+
+            // Move, bounce off the edges, replace a few, drop a few
+            order.clear();
+            for (int i = 0; i < n; ++i) {
+                SimObject& o = sim[i];
+                if (chance(rng) < turnover) spawn(o, rng);
+                o.x += o.vx * dt;
+                o.y += o.vy * dt;
+                if (o.x < 0.0f || o.x > kSize) o.vx = -o.vx;
+                if (o.y < 0.0f || o.y > kSize) o.vy = -o.vy;
+                if (chance(rng) >= dropout) order.push_back(i);
+            }
+            std::shuffle(order.begin(), order.end(), rng);
+            int count = (int)order.size();
+            for (int k = 0; k < count; ++k) {
+                const SimObject& o = sim[order[k]];
+                shaman::Object& obj = objects[k];
+                obj.rect.width = 12.0f;
+                obj.rect.height = 12.0f;
+                obj.rect.x = o.x - obj.rect.width * 0.5f;  // top-left, y up
+                obj.rect.y = o.y + obj.rect.height * 0.5f;
+            }
+
+            uint64_t start = monotonic_ns();
+            UpdateObjectTracks(objects.data(), count, timestamp_us, tracked.data());
+            uint64_t elapsed = monotonic_ns() - start;
+
+            bool measured = f >= kWarmupFrames;
+            for (int k = 0; k < count; ++k) {
+                SimObject& o = sim[order[k]];
+                if (measured && o.last_id != 0) {
+                    continued++;
+                    if (tracked[k].id != o.last_id) switches++;
+                }
+                o.last_id = tracked[k].id;
+            }
+            if (!measured) continue;
+            cost_us.push_back(elapsed / 1e3);
+            total_ns += elapsed;
+            detections += count;
+        }
+
+        std::sort(cost_us.begin(), cost_us.end());
+        size_t m = cost_us.size();
+        printf("%8d %8d %10.1f %10.1f %10.1f %10.1f %9.3f%%\n", n, frames, cost_us[m / 2],
+               cost_us[std::min(m - 1, m * 99 / 100)], cost_us[m - 1],
+               detections ? (double)total_ns / detections : 0.0, continued ? 100.0 * switches / continued : 0.0);
+    }
+    return 0;
+}
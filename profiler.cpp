@@ -0,0 +1,213 @@
+#include "profiler.h"
+#include "imgui.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+const uint64_t kRingSize = 1 << 16;  // zones kept per thread, power of two
+const uint64_t kMinCaptureIntervalNs = 5000000000ull;  // at most one spike trace per 5 s
+
+struct ZoneEvent {
+    const char* name;
+    uint64_t begin_ns;
+    uint64_t end_ns;
+};
+
+// Written only by its owning thread; exporters copy it and then discard
+// whatever the owner may have overwritten meanwhile
+struct ThreadRing {
+    std::atomic<uint64_t> head{0};  // zones ever recorded, slot = index % kRingSize
+    int tid;
+    char name[32];
+    ZoneEvent events[kRingSize];
+};
+
+static std::atomic<bool> enabled{true};
+static std::mutex rings_mutex;  // thread registration and export only
+static std::vector<ThreadRing*> rings;
+static thread_local ThreadRing* local_ring = nullptr;
+
+static float dump_window_s = 10.0f;
+static std::atomic<float> capture_pre_s{2.0f};
+static std::atomic<float> capture_post_s{1.0f};
+static std::atomic<uint64_t> capture_at_ns{0};  // pending spike, 0 if none
+static std::atomic<uint64_t> last_capture_ns{0};
+static std::atomic<uint64_t> captures_written{0};
+static std::atomic<uint64_t> captures_skipped{0};
+static std::string last_trace;  // UI thread
+
+static ThreadRing* thread_ring() {
+    if (!local_ring) {
+        // Never freed, so zones from finished threads can still be exported
+        ThreadRing* ring = new ThreadRing;
+        ring->tid = (int)syscall(SYS_gettid);
+        std::snprintf(ring->name, sizeof(ring->name), "thread %d", ring->tid);
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(ring);
+        local_ring = ring;
+    }
+    return local_ring;
+}
+
+// Appends the ring's zones that overlap [from_ns, to_ns]
+static void collect(const ThreadRing* ring, uint64_t from_ns, uint64_t to_ns, std::vector<ZoneEvent>& out) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t first = head > kRingSize ? head - kRingSize : 0;
+    size_t start = out.size();
+    for (uint64_t i = first; i < head; ++i) {
+        out.push_back(ring->events[i % kRingSize]);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = ring->head.load(std::memory_order_relaxed);
+    // The owner may be rewriting slot after - kRingSize right now
+    uint64_t valid = after >= kRingSize ? after - kRingSize + 1 : 0;
+
+    size_t kept = start;
+    for (uint64_t i = first; i < head; ++i) {
+        const ZoneEvent& e = out[start + (i - first)];
+        if (i < valid || e.end_ns < from_ns || e.begin_ns > to_ns) continue;
+        out[kept++] = e;
+    }
+    out.resize(kept);
+}
+
+static bool write_trace(const char* path, uint64_t from_ns, uint64_t to_ns) {
+    FILE* f = std::fopen(path, "w");
+    if (!f) {
+        std::perror("failed to write profile trace");
+        return false;
+    }
+    const int pid = (int)getpid();
+    std::vector<ZoneEvent> events;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const ThreadRing* ring : rings) {
+        std::fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",\n", pid, ring->tid, ring->name);
+        first = false;
+
+        events.clear();
+        collect(ring, from_ns, to_ns, events);
+        for (const ZoneEvent& e : events) {
+            // microseconds from the start of the window
+            double ts = e.begin_ns > from_ns ? (e.begin_ns - from_ns) / 1000.0 : 0.0;
+            double dur = e.end_ns > e.begin_ns ? (e.end_ns - e.begin_ns) / 1000.0 : 0.0;
+            std::fprintf(f, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         e.name, pid, ring->tid, ts, dur);
+        }
+    }
+    std::fprintf(f, "\n]}\n");
+    std::fclose(f);
+    std::printf("wrote %s\n", path);
+    return true;
+}
+
+static std::string timestamped_name(const char* format) {
+    char name[64];
+    std::time_t t = std::time(nullptr);
+    std::strftime(name, sizeof(name), format, std::localtime(&t));
+    return name;
+}
+}
+
+uint64_t ProfileNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void RecordProfileZone(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+    if (!enabled.load(std::memory_order_relaxed)) return;
+    ThreadRing* ring = thread_ring();
+    uint64_t i = ring->head.load(std::memory_order_relaxed);
+    ZoneEvent& e = ring->events[i % kRingSize];
+    e.name = name;
+    e.begin_ns = begin_ns;
+    e.end_ns = end_ns;
+    ring->head.store(i + 1, std::memory_order_release);
+}
+
+ProfileZone::ProfileZone(const char* name)
+    : name_(name), begin_ns_(enabled.load(std::memory_order_relaxed) ? ProfileNowNs() : 0) {}
+
+ProfileZone::~ProfileZone() {
+    if (begin_ns_ != 0) RecordProfileZone(name_, begin_ns_, ProfileNowNs());
+}
+
+void SetProfilerThreadName(const char* name) {
+    ThreadRing* ring = thread_ring();
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    std::snprintf(ring->name, sizeof(ring->name), "%s", name);
+}
+
+bool DumpProfileTrace(const char* path, double window_seconds) {
+    uint64_t now = ProfileNowNs();
+    uint64_t window = (uint64_t)(window_seconds * 1e9);
+    return write_trace(path, now > window ? now - window : 0, now);
+}
+
+void RequestProfileCapture() {
+    uint64_t now = ProfileNowNs();
+    uint64_t last = last_capture_ns.load();
+    uint64_t none = 0;
+    if ((last != 0 && now - last < kMinCaptureIntervalNs) || !capture_at_ns.compare_exchange_strong(none, now)) {
+        captures_skipped++;
+        return;
+    }
+    last_capture_ns = now;
+}
+
+void ServiceProfileCaptures() {
+    uint64_t at = capture_at_ns.load();
+    if (at == 0) return;
+    uint64_t pre = (uint64_t)(capture_pre_s.load() * 1e9);
+    uint64_t post = (uint64_t)(capture_post_s.load() * 1e9);
+    if (ProfileNowNs() < at + post) return;
+
+    std::string path = timestamped_name("trace_spike_%Y%m%d_%H%M%S.json");
+    if (write_trace(path.c_str(), at > pre ? at - pre : 0, at + post)) {
+        captures_written++;
+        last_trace = path;
+    }
+    capture_at_ns = 0;
+}
+
+void RenderProfilerControls() {
+    PROFILE_ZONE("RenderProfilerControls");
+    ImGui::Begin("Profiler");
+    bool on = enabled;
+    if (ImGui::Checkbox("Record Zones", &on)) enabled = on;
+    ImGui::SliderFloat("Dump Window (s)", &dump_window_s, 1.0f, 30.0f, "%.0f");
+    if (ImGui::Button("Dump Trace (F9)") || ImGui::IsKeyPressed(ImGuiKey_F9, false)) {
+        std::string path = timestamped_name("trace_%Y%m%d_%H%M%S.json");
+        if (DumpProfileTrace(path.c_str(), dump_window_s)) last_trace = path;
+    }
+
+    ImGui::Separator();
+    ImGui::Text("Latency spike capture");
+    float pre = capture_pre_s;
+    float post = capture_post_s;
+    if (ImGui::SliderFloat("Before Spike (s)", &pre, 0.1f, 10.0f, "%.1f")) capture_pre_s = pre;
+    if (ImGui::SliderFloat("After Spike (s)", &post, 0.1f, 5.0f, "%.1f")) capture_post_s = post;
+    ImGui::Text("Captured: %llu  Skipped: %llu", (unsigned long long)captures_written.load(),
+                (unsigned long long)captures_skipped.load());
+    if (capture_at_ns != 0) ImGui::TextColored(ImVec4(1, 1, 0, 1), "Capture pending");
+    if (!last_trace.empty()) ImGui::Text("Last trace: %s", last_trace.c_str());
+
+    ImGui::Separator();
+    ImGui::Text("%-12s %12s", "Thread", "Zones");
+    std::lock_guard<std::mutex> lock(rings_mutex);
+    for (const ThreadRing* ring : rings) {
+        ImGui::Text("%-12s %12llu", ring->name, (unsigned long long)ring->head.load(std::memory_order_relaxed));
+    }
+    ImGui::End();
+}
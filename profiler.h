@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+
+// Scoped CPU timing zones. Each thread records into its own fixed ring of
+// the most recent zones, so recording takes no lock and never allocates
+// after the thread's first zone. Zone names must be string literals.
+//
+//     void DrawThing() {
+//         PROFILE_ZONE("DrawThing");
+//         ...
+//     }
+
+uint64_t ProfileNowNs();  // CLOCK_MONOTONIC
+void RecordProfileZone(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+
+private:
+    const char* name_;
+    uint64_t begin_ns_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+// Label for the calling thread in exported traces
+void SetProfilerThreadName(const char* name);
+
+// Writes the zones from the last window_seconds as Chrome trace JSON, for
+// chrome://tracing or ui.perfetto.dev. Returns false if the file can't be written.
+bool DumpProfileTrace(const char* path, double window_seconds);
+
+// Any thread, e.g. on a latency spike. The UI thread writes a trace around
+// the request time once the post-spike window has been recorded.
+void RequestProfileCapture();
+void ServiceProfileCaptures();
+
+void RenderProfilerControls();
@@ -0,0 +1,119 @@
+#include "projection.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PROJECTION_X86 1
+#endif
+
+const char* const kProjectionKernelNames[PROJECTION_KERNEL_COUNT] = { "Scalar", "SSE", "AVX2" };
+
+namespace {
+static void project_scalar(const float* xy, int begin, int count, const CalibrationTransform& t,
+                           float* out_x, float* out_y) {
+    const float* m = t.m;
+    for (int i = begin; i < count; ++i) {
+        float x = xy[2 * i];
+        float y = xy[2 * i + 1];
+        float inv_w = 1.0f / (m[6] * x + m[7] * y + m[8]);
+        out_x[i] = (m[0] * x + m[1] * y + m[2]) * inv_w;
+        out_y[i] = (m[3] * x + m[4] * y + m[5]) * inv_w;
+    }
+}
+
+#ifdef PROJECTION_X86
+static void project_sse(const float* xy, int count, const CalibrationTransform& t, float* out_x, float* out_y) {
+    const float* m = t.m;
+    const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+    const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+    const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+    const __m128 one = _mm_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 a = _mm_loadu_ps(xy + 2 * i);      // x0 y0 x1 y1
+        __m128 b = _mm_loadu_ps(xy + 2 * i + 4);  // x2 y2 x3 y3
+        __m128 x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 inv_w = _mm_div_ps(one, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, x), _mm_mul_ps(m7, y)), m8));
+        _mm_storeu_ps(out_x + i, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, x), _mm_mul_ps(m1, y)), m2), inv_w));
+        _mm_storeu_ps(out_y + i, _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, x), _mm_mul_ps(m4, y)), m5), inv_w));
+    }
+    project_scalar(xy, i, count, t, out_x, out_y);
+}
+
+__attribute__((target("avx2,fma")))
+static void project_avx2(const float* xy, int count, const CalibrationTransform& t, float* out_x, float* out_y) {
+    const float* m = t.m;
+    const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+    const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+    const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 a = _mm256_loadu_ps(xy + 2 * i);      // x0 y0 .. x3 y3
+        __m256 b = _mm256_loadu_ps(xy + 2 * i + 8);  // x4 y4 .. x7 y7
+        // per 128-bit lane: x0 x1 x4 x5 | x2 x3 x6 x7, then put the 64-bit pairs back in order
+        __m256 x = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 y = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(x), _MM_SHUFFLE(3, 1, 2, 0)));
+        y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(y), _MM_SHUFFLE(3, 1, 2, 0)));
+        __m256 inv_w = _mm256_div_ps(one, _mm256_fmadd_ps(m6, x, _mm256_fmadd_ps(m7, y, m8)));
+        _mm256_storeu_ps(out_x + i, _mm256_mul_ps(_mm256_fmadd_ps(m0, x, _mm256_fmadd_ps(m1, y, m2)), inv_w));
+        _mm256_storeu_ps(out_y + i, _mm256_mul_ps(_mm256_fmadd_ps(m3, x, _mm256_fmadd_ps(m4, y, m5)), inv_w));
+    }
+    // The tail runs non-VEX code; clear the upper halves first or every
+    // call pays an AVX/SSE transition stall
+    _mm256_zeroupper();
+    project_scalar(xy, i, count, t, out_x, out_y);
+}
+#endif
+
+static ProjectionKernel detect_kernel() {
+#ifdef PROJECTION_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return PROJECTION_AVX2;
+    if (__builtin_cpu_supports("sse")) return PROJECTION_SSE;
+#endif
+    return PROJECTION_SCALAR;
+}
+
+static const ProjectionKernel best_kernel = detect_kernel();
+}
+
+CalibrationTransform MakeCalibrationTransform(float offset_x, float offset_y, float scale, int width, int height) {
+    // sx = width - ((x - offset_x) / scale * height + (width - height) / 2)
+    // sy = (y - offset_y) / scale * height
+    const float k = height / scale;
+    const float center = (width - height) / 2;
+    CalibrationTransform t = {{ -k, 0.0f, width - center + offset_x * k,
+                                0.0f, k, -offset_y * k,
+                                0.0f, 0.0f, 1.0f }};
+    return t;
+}
+
+ProjectionKernel GetProjectionKernel() {
+    return best_kernel;
+}
+
+bool ProjectionKernelSupported(ProjectionKernel kernel) {
+    return kernel <= best_kernel;
+}
+
+void ProjectPoints(const float* xy, int count, const CalibrationTransform& t, float* out_x, float* out_y) {
+    ProjectPointsWith(best_kernel, xy, count, t, out_x, out_y);
+}
+
+void ProjectPointsWith(ProjectionKernel kernel, const float* xy, int count, const CalibrationTransform& t,
+                       float* out_x, float* out_y) {
+    switch (kernel) {
+#ifdef PROJECTION_X86
+    case PROJECTION_AVX2:
+        project_avx2(xy, count, t, out_x, out_y);
+        return;
+    case PROJECTION_SSE:
+        project_sse(xy, count, t, out_x, out_y);
+        return;
+#endif
+    default:
+        project_scalar(xy, 0, count, t, out_x, out_y);
+        return;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Projective map (homography) from camera pixels to spotlight window
+// pixels, row-major 3x3:
+//   w  = m[6] * x + m[7] * y + m[8]
+//   sx = (m[0] * x + m[1] * y + m[2]) / w
+//   sy = (m[3] * x + m[4] * y + m[5]) / w
+struct CalibrationTransform {
+    float m[9];
+};
+
+// The offset/scale calibration from the Spotlight panel: camera square of
+// side `scale` at (offset_x, offset_y) fills the window height, centered
+// horizontally and mirrored in x for the projector
+CalibrationTransform MakeCalibrationTransform(float offset_x, float offset_y, float scale, int width, int height);
+
+enum ProjectionKernel {
+    PROJECTION_SCALAR,
+    PROJECTION_SSE,
+    PROJECTION_AVX2,
+    PROJECTION_KERNEL_COUNT
+};
+
+extern const char* const kProjectionKernelNames[PROJECTION_KERNEL_COUNT];
+
+// Fastest kernel this CPU supports, picked once at startup
+ProjectionKernel GetProjectionKernel();
+bool ProjectionKernelSupported(ProjectionKernel kernel);
+
+// Transforms count interleaved (x, y) camera points into separate screen x
+// and y arrays. The arrays need no particular alignment.
+void ProjectPoints(const float* xy, int count, const CalibrationTransform& t, float* out_x, float* out_y);
+void ProjectPointsWith(ProjectionKernel kernel, const float* xy, int count, const CalibrationTransform& t,
+                       float* out_x, float* out_y);
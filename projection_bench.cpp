@@ -0,0 +1,98 @@
+// Microbenchmark for the camera-to-projector projection kernels.
+//
+//   projection_bench [--objects 10,100,1000,10000] [--seconds 0.2]
+//
+// Times every kernel the CPU supports at each object count and checks its
+// output against the scalar kernel.
+#include "projection.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <time.h>
+
+namespace {
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+std::vector<int> parse_counts(const char* s) {
+    std::vector<int> counts;
+    while (*s) {
+        counts.push_back(atoi(s));
+        const char* comma = strchr(s, ',');
+        if (!comma) break;
+        s = comma + 1;
+    }
+    return counts;
+}
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> counts = {10, 100, 1000, 10000};
+    double seconds = 0.2;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--objects") && i + 1 < argc) {
+            counts = parse_counts(argv[++i]);
+        } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--objects 10,100,1000,10000] [--seconds 0.2]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    CalibrationTransform t = MakeCalibrationTransform(545.0f, 379.0f, 1254.0f, 1920, 1080);
+    t.m[6] = 2e-5f;  // a little keystone, like a fitted homography
+    t.m[7] = -1e-5f;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> coord(0.0f, 2048.0f);
+
+    printf("best kernel: %s\n", kProjectionKernelNames[GetProjectionKernel()]);
+    printf("%8s %8s %12s %12s %12s\n", "objects", "kernel", "ns/frame", "ns/object", "max err px");
+    for (int n : counts) {
+        std::vector<float> xy(2 * n);
+        for (float& v : xy) v = coord(rng);
+        std::vector<float> ref_x(n), ref_y(n), out_x(n), out_y(n);
+        ProjectPointsWith(PROJECTION_SCALAR, xy.data(), n, t, ref_x.data(), ref_y.data());
+
+        for (int k = 0; k < PROJECTION_KERNEL_COUNT; ++k) {
+            ProjectionKernel kernel = (ProjectionKernel)k;
+            if (!ProjectionKernelSupported(kernel)) continue;
+
+            // calibrate the batch size to roughly 1 ms, then repeat for the time budget
+            int batch = 1;
+            while (true) {
+                uint64_t start = monotonic_ns();
+                for (int r = 0; r < batch; ++r) {
+                    ProjectPointsWith(kernel, xy.data(), n, t, out_x.data(), out_y.data());
+                }
+                if (monotonic_ns() - start > 1000000 || batch > (1 << 24)) break;
+                batch *= 2;
+            }
+            uint64_t best_ns = ~0ull;
+            uint64_t deadline = monotonic_ns() + (uint64_t)(seconds * 1e9);
+            while (monotonic_ns() < deadline) {
+                uint64_t start = monotonic_ns();
+                for (int r = 0; r < batch; ++r) {
+                    ProjectPointsWith(kernel, xy.data(), n, t, out_x.data(), out_y.data());
+                }
+                best_ns = std::min(best_ns, monotonic_ns() - start);
+            }
+
+            float max_err = 0.0f;
+            for (int i = 0; i < n; ++i) {
+                max_err = std::max(max_err, std::fabs(out_x[i] - ref_x[i]));
+                max_err = std::max(max_err, std::fabs(out_y[i] - ref_y[i]));
+            }
+            double per_frame = (double)best_ns / batch;
+            printf("%8d %8s %12.1f %12.3f %12.5f\n", n, kProjectionKernelNames[k], per_frame, per_frame / n, max_err);
+        }
+    }
+    return 0;
+}
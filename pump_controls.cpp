@@ -1,4 +1,6 @@
 #include "pump_controls.h"
+#include "profiler.h"
+#include "pump_scheduler.h"
 #include "serial/serial.h"
 #include "imgui.h"
 #include "spotlight_controls.h"
@@ -11,6 +13,8 @@ namespace {
 static SerialPort serial;
 static std::vector<std::string> port_list;
 static int selected_port = -1;
+static int baud_index = DefaultBaudRateIndex();
+static bool use_binary = true;
 static char send_buffer[128] = "";
 static std::string recv_data;
 
@@ -26,11 +30,34 @@ static bool randomize[3] = {false, false, false};
 static int repeat_delay[3] = {10, 10, 10};
 static int random_min_delay[3] = {5, 5, 5};
 static int random_max_delay[3] = {100, 100, 100};
-static double last_sent_time[3] = {0.0, 0.0, 0.0};
-static bool curr_running[3] = {false, false, false};
+static uint64_t dispenses_shown = 0;
+
+// The repeat settings for pump i, for the scheduler thread
+DispenseSchedule schedule_for(int i, bool running) {
+    DispenseSchedule s;
+    s.running = running;
+    s.pump = pump_ids[i];
+    s.push = push_directions[i] == 1;
+    s.by_volume = control_mode[i] == 0;
+    s.microliters = microliters[i];
+    s.delivery_ms = delivery_ms[i];
+    s.cycles = cycles[i];
+    s.delay_us = delays[i];
+    s.randomize = randomize[i];
+    s.interval_s = repeat_delay[i];
+    s.min_interval_s = random_min_delay[i];
+    s.max_interval_s = random_max_delay[i];
+    return s;
+}
 }
 
 void RenderPumpControls() {
+    PROFILE_ZONE("RenderPumpControls");
+    // Flash the dynamic circle for each scheduled dispense
+    for (uint64_t sent = GetScheduledDispenseCount(); dispenses_shown < sent; ++dispenses_shown) {
+        TriggerDynamicCircle();
+    }
+
     if (ImGui::Begin("Serial Control")) {
         // window for serial communication functions
 
@@ -53,14 +80,32 @@ void RenderPumpControls() {
             }
         }
 
+        if (!serial.is_open()) {
+            ImGui::Combo("Baud", &baud_index, kBaudRateLabels, kBaudRateCount);
+            ImGui::Checkbox("Binary protocol", &use_binary);
+        }
+
         if (!serial.is_open() && selected_port >= 0) {
-            if (ImGui::Button("Open Port")) {
-                serial.open(port_list[selected_port]);
-                const auto& configs = get_loaded_pump_configs(config_files[0]);
-                initialize_pump_state_from_config(configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);  
+            if (ImGui::Button("Open Port") && serial.open(port_list[selected_port], kBaudRates[baud_index])) {
+                if (use_binary) serial.negotiate_binary(3000);
+                PumpConfigSnapshot configs = get_loaded_pump_configs(config_files[0]);
+                if (configs) initialize_pump_state_from_config(*configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);  
             }
         } else if (serial.is_open()) {
-            ImGui::Text("Port Open");
+            ImGui::Text("Port Open at %d baud, %s", serial.baud_rate(),
+                        serial.is_negotiating() ? "negotiating binary..." : serial.is_binary() ? "binary" : "ASCII");
+            SerialPort::Stats stats = serial.stats();
+            ImGui::Text("Sent %llu commands in %llu writes, %llu dropped, %llu failed",
+                        (unsigned long long)stats.queued, (unsigned long long)stats.writes,
+                        (unsigned long long)stats.dropped, (unsigned long long)stats.errors);
+            SerialPort::AckStats acks = serial.ack_stats();
+            ImGui::Text("Acks %llu, in flight %d; RTT last %.2f ms, mean %.2f ms, max %.2f ms",
+                        (unsigned long long)acks.acked, acks.in_flight, acks.last_rtt_ms, acks.mean_rtt_ms, acks.max_rtt_ms);
+            if (acks.late > 0 || acks.lost > 0) {
+                ImGui::TextColored(ImVec4(1, 0, 0, 1), "%llu late (> %d ms), %llu lost (no ack in %d ms)",
+                                   (unsigned long long)acks.late, SerialPort::kLateAckMs,
+                                   (unsigned long long)acks.lost, SerialPort::kLostAckMs);
+            }
             if (ImGui::Button("Close Port")) {
                 serial.close();
             }
@@ -88,16 +133,15 @@ void RenderPumpControls() {
             }
 
             if (serial.is_open()) {
-                if (curr_running[i]) {
+                if (IsPumpScheduleRunning(i)) {
                     if (ImGui::Button("Stop Command")) {
-                        curr_running[i] = false;
-                        last_sent_time[i] = 0.0;
+                        SetPumpSchedule(i, schedule_for(i, false));
                     } ImGui::SameLine();
 
                 } else {
                     if (ImGui::Button("Send Command")) {
                         if (repeat[i]) {
-                            curr_running[i] = true;
+                            SetPumpSchedule(i, schedule_for(i, true));
                         } else {
                             bool is_push = (push_directions[i] == 1);
                             if (control_mode[i] == 0) {
@@ -106,14 +150,13 @@ void RenderPumpControls() {
                             else {
                                 serial.send_pump_command(pump_ids[i], is_push, cycles[i], delays[i]);
                             }
+                            std::time_t dispense_time = std::time(nullptr);
+                            char ts[64];
+                            std::strftime(ts, sizeof(ts), "[%Y-%m-%d %H:%M:%S] ", std::localtime(&dispense_time));
+                            std::cout << ts << "Dispensing pump " << pump_ids[i] << std::endl;
+                            // Use setter for dynamic circle if needed
+                            TriggerDynamicCircle();
                         }
-                        std::time_t dispense_time = std::time(nullptr);
-                        char ts[64];
-                        std::strftime(ts, sizeof(ts), "[%Y-%m-%d %H:%M:%S] ", std::localtime(&dispense_time));
-                        std::cout << ts << "Dispensing pump " << pump_ids[i] << std::endl;
-                        // Use setter for dynamic circle if needed
-                        RefDynamicCircleStartTime() = ImGui::GetTime();
-                        RefDynamicCircleRadius() = 0.00f;
                     } ImGui::SameLine();
                 }
 
@@ -130,27 +173,13 @@ void RenderPumpControls() {
                     ImGui::SliderInt("Max Delay", &random_max_delay[i], 5, 6000);
                 }
 
-                double now = ImGui::GetTime();
-
-                if (repeat[i] && (now - last_sent_time[i] >= repeat_delay[i]) && curr_running[i]) {
-                    bool is_push = (push_directions[i] == 1);
-                    if (control_mode[i] == 0) {
-                        serial.send_pump_command(pump_ids[i], is_push, microliters[i], delivery_ms[i]);
-                    }
-                    else {
-                        serial.send_pump_command(pump_ids[i], is_push, cycles[i], delays[i]);
-                    }
-                    if (randomize[i]) {
-                        // Randomize the repeat delay
-                        repeat_delay[i] = random_min_delay[i] + (rand() % (random_max_delay[i] - random_min_delay[i] + 1));
-                    }
-                    last_sent_time[i] = now;
-                    std::time_t dispense_time = std::time(nullptr);
-                    char ts[64];
-                    std::strftime(ts, sizeof(ts), "[%Y-%m-%d %H:%M:%S] ", std::localtime(&dispense_time));
-                    std::cout << ts << "Dispensing pump " << pump_ids[i] << std::endl;
-                    RefDynamicCircleStartTime() = ImGui::GetTime();
-                    RefDynamicCircleRadius() = 0.00f;
+                // The scheduler thread sends the repeats; this only keeps
+                // its copy of the settings current
+                if (IsPumpScheduleRunning(i)) {
+                    SetPumpSchedule(i, schedule_for(i, repeat[i]));
+                    DispenseStats stats = GetPumpScheduleStats(i);
+                    ImGui::Text("Next in %.1f s; sent %llu, late by %.0f us (max %.0f us)", stats.next_in_s,
+                                (unsigned long long)stats.sent, stats.last_late_us, stats.max_late_us);
                 }
             }
 
@@ -162,15 +191,15 @@ void RenderPumpControls() {
             if (ImGui::Button("Send All Commands")) {
                 for (int i = 0; i < 3; ++i) {
                     if (repeat[i]) {
-                        curr_running[i] = true;
-                    } else {
-                        bool is_push = (push_directions[i] == 1);
-                        if (control_mode[i] == 0) {
-                            serial.send_pump_command(pump_ids[i], is_push, microliters[i], delivery_ms[i]);
-                        }
-                        else {
-                            serial.send_pump_command(pump_ids[i], is_push, cycles[i], delays[i]);
-                        }
+                        SetPumpSchedule(i, schedule_for(i, true));  // logged by the scheduler
+                        continue;
+                    }
+                    bool is_push = (push_directions[i] == 1);
+                    if (control_mode[i] == 0) {
+                        serial.send_pump_command(pump_ids[i], is_push, microliters[i], delivery_ms[i]);
+                    }
+                    else {
+                        serial.send_pump_command(pump_ids[i], is_push, cycles[i], delays[i]);
                     }
                     std::time_t dispense_time = std::time(nullptr);
                     char ts[64];
@@ -180,8 +209,7 @@ void RenderPumpControls() {
             } ImGui::SameLine();
             if (ImGui::Button("Stop All Commands")) {
                 for (int i = 0; i < 3; ++i) {
-                    curr_running[i] = false;
-                    last_sent_time[i] = 0.0;
+                    SetPumpSchedule(i, schedule_for(i, false));
                 }
             }
         } else {
@@ -200,10 +228,8 @@ void RenderPumpControls() {
                     selected_config_index = i;
                     current_config_file = config_files[i];
 
-                    if (load_pump_config(current_config_file, cfg)) {
-                        const auto& configs = get_loaded_pump_configs(current_config_file);
-
-                        initialize_pump_state_from_config(configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);      
+                    if (PumpConfigSnapshot configs = get_loaded_pump_configs(current_config_file)) {
+                        initialize_pump_state_from_config(*configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);      
                     }
                 }
                 if (is_selected) ImGui::SetItemDefaultFocus();
@@ -215,10 +241,8 @@ void RenderPumpControls() {
             config_files = list_json_files_in_folder();  // refresh file list
             if (!config_files.empty() && selected_config_index < config_files.size()) {
                 current_config_file = config_files[selected_config_index];
-                if (load_pump_config(current_config_file, cfg)) {
-                    const auto& configs = get_loaded_pump_configs(current_config_file);
-
-                    initialize_pump_state_from_config(configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);    
+                if (PumpConfigSnapshot configs = get_loaded_pump_configs(current_config_file)) {
+                    initialize_pump_state_from_config(*configs, pump_ids, microliters, delivery_ms, cycles, delays, push_directions, control_mode, repeat, repeat_delay);    
                 }
             }
         }
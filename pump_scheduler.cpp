@@ -0,0 +1,258 @@
+#include "pump_scheduler.h"
+#include "profiler.h"
+#include "serial/serial.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <queue>
+#include <random>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+// Floor for every interval; 0 would leave a slot due forever
+const double kMinIntervalS = 0.001;
+
+struct Deadline {
+    uint64_t at_ns;  // CLOCK_MONOTONIC, as ProfileNowNs
+    int slot;
+    uint64_t generation;  // stale once the slot is restarted, retimed or stopped
+    bool operator>(const Deadline& other) const { return at_ns > other.at_ns; }
+};
+
+struct Slot {
+    DispenseSchedule schedule;
+    uint64_t generation;
+    uint64_t next_ns;         // pending deadline, 0 when stopped
+    uint64_t last_due_ns;     // deadline of the last dispense
+    DispenseStats stats;
+};
+
+struct Sent {
+    char pump;
+    bool skipped;
+    uint64_t due_ns, sent_ns;
+};
+
+static std::mutex mutex;  // guards everything below but the atomics
+static Slot slots[kScheduledPumps];
+static std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline> > deadlines;
+static std::mt19937 rng(std::random_device{}());
+static SerialPort* port = nullptr;
+
+static std::thread scheduler_thread;
+static std::atomic<bool> scheduler_running(false);
+static int timer_fd = -1;
+static int wake_fd = -1;
+static std::atomic<uint64_t> dispense_count(0);
+
+uint64_t seconds_to_ns(double seconds) {
+    return seconds > 0.0 ? (uint64_t)(seconds * 1e9) : 0;
+}
+
+double draw_interval(const DispenseSchedule& s) {
+    if (!s.randomize) return s.interval_s;
+    std::uniform_real_distribution<double> interval(std::min(s.min_interval_s, s.max_interval_s),
+                                                    std::max(s.min_interval_s, s.max_interval_s));
+    return interval(rng);
+}
+
+bool timing_changed(const DispenseSchedule& a, const DispenseSchedule& b) {
+    return a.randomize != b.randomize || a.interval_s != b.interval_s ||
+           a.min_interval_s != b.min_interval_s || a.max_interval_s != b.max_interval_s;
+}
+
+void schedule_slot(int index, uint64_t at_ns) {
+    Slot& slot = slots[index];
+    slot.generation++;
+    slot.next_ns = at_ns;
+    Deadline d = { at_ns, index, slot.generation };
+    deadlines.push(d);
+}
+
+void wake_scheduler() {
+    if (wake_fd < 0) return;
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) perror("eventfd write");
+}
+
+void log_dispense(const Sent& sent) {
+    std::time_t wall = std::time(nullptr);
+    char ts[64];
+    std::strftime(ts, sizeof(ts), "[%Y-%m-%d %H:%M:%S] ", std::localtime(&wall));
+    char line[160];
+    if (sent.skipped) {
+        snprintf(line, sizeof(line), "Skipped pump %c, port closed: due %.6f s", sent.pump, sent.due_ns / 1e9);
+    } else {
+        snprintf(line, sizeof(line), "Dispensing pump %c: due %.6f s, sent %.6f s (%+.0f us)", sent.pump,
+                 sent.due_ns / 1e9, sent.sent_ns / 1e9, ((double)sent.sent_ns - (double)sent.due_ns) / 1e3);
+    }
+    std::cout << ts << line << std::endl;
+}
+
+// Sends everything that is due and queues each slot's next deadline.
+// Returns the earliest pending deadline, or 0 if none.
+uint64_t dispense_due(Sent* sent, int& sent_count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t now = ProfileNowNs();
+    // Each slot's next deadline lands after now, so a slot sends at most
+    // once per call and sent[] holds one record per slot
+    while (!deadlines.empty() && deadlines.top().at_ns <= now && sent_count < kScheduledPumps) {
+        Deadline d = deadlines.top();
+        deadlines.pop();
+        Slot& slot = slots[d.slot];
+        if (d.generation != slot.generation || !slot.schedule.running) continue;
+
+        const DispenseSchedule& s = slot.schedule;
+        Sent& record = sent[sent_count++];
+        record.pump = s.pump;
+        record.due_ns = d.at_ns;
+        record.skipped = !port || !port->is_open();
+        if (!record.skipped) {
+            PROFILE_ZONE("scheduled dispense");
+            if (s.by_volume) port->send_pump_command(s.pump, s.push, s.microliters, s.delivery_ms);
+            else port->send_pump_command(s.pump, s.push, s.cycles, s.delay_us);
+        }
+        record.sent_ns = ProfileNowNs();
+
+        DispenseStats& stats = slot.stats;
+        if (record.skipped) {
+            stats.skipped++;
+        } else {
+            stats.sent++;
+            stats.last_late_us = (record.sent_ns - d.at_ns) / 1e3;
+            stats.max_late_us = std::max(stats.max_late_us, stats.last_late_us);
+        }
+
+        // Step from the deadline, not the send, so lateness does not
+        // accumulate; after a long stall, resume from now instead of
+        // sending the missed dispenses in a burst
+        slot.last_due_ns = d.at_ns;
+        uint64_t next = d.at_ns + seconds_to_ns(draw_interval(s));
+        if (next <= now) next = now + seconds_to_ns(draw_interval(s));
+        schedule_slot(d.slot, next);
+    }
+    return deadlines.empty() ? 0 : deadlines.top().at_ns;
+}
+
+void scheduler_loop() {
+    SetProfilerThreadName("pump scheduler");
+    prctl(PR_SET_TIMERSLACK, 1);  // the default 50 us slack would all be lateness
+
+    while (scheduler_running) {
+        Sent sent[kScheduledPumps];
+        int sent_count = 0;
+        uint64_t next_ns = dispense_due(sent, sent_count);
+
+        for (int i = 0; i < sent_count; ++i) {
+            if (!sent[i].skipped) dispense_count++;
+            log_dispense(sent[i]);
+        }
+
+        // Absolute deadline on CLOCK_MONOTONIC; all zero disarms the timer
+        itimerspec timer = {};
+        timer.it_value.tv_sec = next_ns / 1000000000ull;
+        timer.it_value.tv_nsec = next_ns % 1000000000ull;
+        if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr) != 0) perror("timerfd_settime");
+
+        pollfd fds[2] = { { timer_fd, POLLIN, 0 }, { wake_fd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) perror("poll pump scheduler");
+        uint64_t value;
+        if ((fds[0].revents & POLLIN) && read(timer_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) perror("timerfd read");
+        if ((fds[1].revents & POLLIN) && read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) perror("eventfd read");
+    }
+}
+}
+
+void StartPumpScheduler(SerialPort& serial) {
+    if (scheduler_running) return;
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (timer_fd < 0 || wake_fd < 0) {
+        perror("pump scheduler");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        port = &serial;
+    }
+    scheduler_running = true;
+    scheduler_thread = std::thread(scheduler_loop);
+}
+
+void StopPumpScheduler() {
+    if (!scheduler_running) return;
+    scheduler_running = false;
+    wake_scheduler();
+    scheduler_thread.join();
+    close(timer_fd);
+    close(wake_fd);
+    timer_fd = wake_fd = -1;
+    std::lock_guard<std::mutex> lock(mutex);
+    port = nullptr;
+}
+
+void SetPumpSchedule(int index, const DispenseSchedule& requested) {
+    if (index < 0 || index >= kScheduledPumps) return;
+    // Config files and ctrl-click typing can both get past the slider ranges
+    DispenseSchedule schedule = requested;
+    schedule.interval_s = std::max(schedule.interval_s, kMinIntervalS);
+    schedule.min_interval_s = std::max(schedule.min_interval_s, kMinIntervalS);
+    schedule.max_interval_s = std::max(schedule.max_interval_s, kMinIntervalS);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Slot& slot = slots[index];
+    bool was_running = slot.schedule.running;
+    bool retime = timing_changed(slot.schedule, schedule);
+    slot.schedule = schedule;
+
+    if (!schedule.running) {
+        if (was_running) {
+            slot.generation++;  // drops the pending deadline
+            slot.next_ns = 0;
+        }
+        return;
+    }
+    uint64_t now = ProfileNowNs();
+    if (!was_running) {
+        slot.stats = DispenseStats();
+        schedule_slot(index, now);  // first dispense right away
+    } else if (retime) {
+        uint64_t next = slot.last_due_ns + seconds_to_ns(draw_interval(schedule));
+        schedule_slot(index, std::max(next, now));
+    } else {
+        return;  // volume or direction edits apply at the next dispense
+    }
+    wake_scheduler();
+}
+
+bool IsPumpScheduleRunning(int index) {
+    if (index < 0 || index >= kScheduledPumps) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    return slots[index].schedule.running;
+}
+
+DispenseStats GetPumpScheduleStats(int index) {
+    DispenseStats stats = {};
+    if (index < 0 || index >= kScheduledPumps) return stats;
+    std::lock_guard<std::mutex> lock(mutex);
+    const Slot& slot = slots[index];
+    stats = slot.stats;
+    uint64_t now = ProfileNowNs();
+    stats.next_in_s = slot.schedule.running ? (slot.next_ns > now ? (slot.next_ns - now) / 1e9 : 0.0) : -1.0;
+    return stats;
+}
+
+uint64_t GetScheduledDispenseCount() {
+    return dispense_count.load();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+class SerialPort;
+
+const int kScheduledPumps = 3;  // one schedule per pump in the Serial Control panel
+
+// Repeat dispensing for one pump, as edited in the Serial Control panel.
+// Intervals are in seconds.
+struct DispenseSchedule {
+    bool running;
+    char pump;
+    bool push;
+    bool by_volume;  // microliters/delivery_ms, otherwise cycles/delay_us
+    float microliters;
+    int delivery_ms;
+    int cycles;
+    int delay_us;
+    bool randomize;
+    double interval_s;                      // fixed
+    double min_interval_s, max_interval_s;  // randomized, uniform
+};
+
+struct DispenseStats {
+    uint64_t sent;
+    uint64_t skipped;  // due while the port was closed
+    double next_in_s;  // -1 when not running
+    double last_late_us, max_late_us;
+};
+
+// Dispensing runs on its own thread: a min-heap of deadlines and a
+// timerfd, so rewards go out on time whatever the UI frame rate. Start
+// once at startup, stop before the port goes away.
+void StartPumpScheduler(SerialPort& port);
+void StopPumpScheduler();
+
+// UI thread, every frame. Starting a schedule dispenses at once, then
+// every interval; edits while running apply from the next dispense.
+// Intervals below 1 ms are raised to 1 ms.
+void SetPumpSchedule(int slot, const DispenseSchedule& schedule);
+bool IsPumpScheduleRunning(int slot);
+DispenseStats GetPumpScheduleStats(int slot);
+
+// Dispenses sent so far, for the UI thread's visual feedback
+uint64_t GetScheduledDispenseCount();
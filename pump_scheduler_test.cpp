@@ -0,0 +1,97 @@
+// Checks that the pump scheduler survives intervals of zero and below.
+//
+//   pump_scheduler_test
+//
+// Such intervals reach SetPumpSchedule from config files and ctrl-click
+// typing. Runs fixed and randomized schedules with them against a pty
+// standing in for the pump board, and fails if the scheduler stops
+// answering or sends faster than the 1 ms floor allows.
+#include "pump_scheduler.h"
+#include "serial/serial.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <pty.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+const double kRunSeconds = 0.3;
+const uint64_t kMaxSends = (uint64_t)(kRunSeconds / 0.001) + 10;  // 1 ms floor, some slack
+
+void on_alarm(int) {
+    const char message[] = "pump scheduler stopped answering\n";
+    if (write(2, message, sizeof(message) - 1) < 0) {}
+    _exit(1);
+}
+
+double monotonic_s() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+}
+
+int main() {
+    int master, slave;
+    char name[64];
+    if (openpty(&master, &slave, name, nullptr, nullptr) != 0) {
+        perror("openpty");
+        return 1;
+    }
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    SerialPort port;
+    if (!port.open(name)) {
+        fprintf(stderr, "failed to open %s\n", name);
+        return 1;
+    }
+
+    // A scheduler spinning on a due slot holds its mutex, so the calls below hang
+    signal(SIGALRM, on_alarm);
+    alarm(5);
+    StartPumpScheduler(port);
+
+    DispenseSchedule fixed = {};
+    fixed.running = true;
+    fixed.pump = 'x';
+    fixed.push = true;
+    fixed.cycles = 0;
+    fixed.delay_us = 50;
+    fixed.interval_s = 0.0;
+    SetPumpSchedule(0, fixed);
+
+    DispenseSchedule randomized = fixed;
+    randomized.pump = 'y';
+    randomized.randomize = true;
+    randomized.min_interval_s = -1.0;
+    randomized.max_interval_s = 0.0;
+    SetPumpSchedule(1, randomized);
+
+    double end = monotonic_s() + kRunSeconds;
+    while (monotonic_s() < end) {
+        char drain[4096];
+        while (read(master, drain, sizeof(drain)) > 0) {}
+        GetPumpScheduleStats(0);
+        usleep(1000);
+    }
+
+    fixed.running = false;
+    randomized.running = false;
+    SetPumpSchedule(0, fixed);
+    SetPumpSchedule(1, randomized);
+    DispenseStats stats[2] = { GetPumpScheduleStats(0), GetPumpScheduleStats(1) };
+    StopPumpScheduler();
+    port.close();
+    alarm(0);
+
+    int failures = 0;
+    for (int i = 0; i < 2; ++i) {
+        printf("slot %d: %llu sent in %.1f s\n", i, (unsigned long long)stats[i].sent, kRunSeconds);
+        if (stats[i].sent == 0 || stats[i].sent > kMaxSends) {
+            fprintf(stderr, "slot %d sent %llu, expected 1..%llu\n", i, (unsigned long long)stats[i].sent,
+                    (unsigned long long)kMaxSends);
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include "ring_renderer.h"
+#include "profiler.h"
+#include "gl_shader.h"
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+namespace {
+const char* kRingVertexShader = R"(
+#version 130
+in vec4 a_mesh;      // cos, sin, colour parity, 1 on the outer edge
+in vec4 a_ring;      // center x, center y, outer radius, inner ratio
+in float a_rotation;
+uniform float u_theta;
+out float v_parity;
+void main() {
+    float a = u_theta + a_rotation;
+    float c = cos(a);
+    float s = sin(a);
+    vec2 dir = vec2(a_mesh.x * c - a_mesh.y * s, a_mesh.x * s + a_mesh.y * c);
+    float r = a_ring.z * mix(a_ring.w, 1.0, a_mesh.w);
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(a_ring.xy + dir * r, 0.0, 1.0);
+    v_parity = a_mesh.z;
+}
+)";
+
+const char* kRingFragmentShader = R"(
+#version 130
+in float v_parity;
+uniform vec4 u_color1;
+uniform vec4 u_color2;
+void main() {
+    gl_FragColor = mix(u_color1, u_color2, v_parity);
+}
+)";
+
+static bool initialized = false;
+static bool supported = false;
+static GLuint program = 0;
+static GLint theta_loc, color1_loc, color2_loc;
+static GLuint mesh_vbo = 0;
+static GLuint instance_vbo = 0;
+static int mesh_segments = -1;
+static std::vector<float> mesh;
+static std::vector<ShapeInstance> shapes;
+
+static void init() {
+    initialized = true;
+    if (!GLEW_VERSION_3_3) {
+        std::cerr << "OpenGL 3.3 instancing unavailable, drawing rings in immediate mode\n";
+        return;
+    }
+    const char* attributes[] = { "a_mesh", "a_ring", "a_rotation" };
+    program = CompileShaderProgram("rings", kRingVertexShader, kRingFragmentShader, attributes, 3);
+    if (!program) return;
+    theta_loc = glGetUniformLocation(program, "u_theta");
+    color1_loc = glGetUniformLocation(program, "u_color1");
+    color2_loc = glGetUniformLocation(program, "u_color2");
+    glGenBuffers(1, &mesh_vbo);
+    glGenBuffers(1, &instance_vbo);
+    supported = true;
+}
+
+// Unit ring as a triangle strip, outer and inner vertex per step
+static void build_mesh(int segments) {
+    mesh.clear();
+    float angle_step = 2.0f * 3.1415926f / segments;
+    for (int i = 0; i <= segments; ++i) {
+        float c = cosf(i * angle_step);
+        float s = sinf(i * angle_step);
+        float parity = (float)(i % 2);
+        float outer[4] = { c, s, parity, 1.0f };
+        float inner[4] = { c, s, parity, 0.0f };
+        mesh.insert(mesh.end(), outer, outer + 4);
+        mesh.insert(mesh.end(), inner, inner + 4);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+    glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(float), mesh.data(), GL_STATIC_DRAW);
+    mesh_segments = segments;
+}
+
+static void draw_filled_ring(float cx, float cy, float r_inner, float r_outer,
+                             ImVec4 color1, ImVec4 color2, int segments, float theta_rotation) {
+    float angle_step = 2.0f * 3.1415926f / segments;
+
+    glBegin(GL_TRIANGLE_STRIP);
+    for (int i = 0; i <= segments; ++i) {
+        float theta = i * angle_step + theta_rotation; // Apply rotation
+        float cos_theta = cosf(theta);
+        float sin_theta = sinf(theta);
+
+        // Alternate colors
+        ImVec4 color = (i % 2 == 0) ? color1 : color2;
+        glColor4f(color.x, color.y, color.z, color.w);
+
+        // Outer vertex
+        glVertex2f(cx + cos_theta * r_outer, cy + sin_theta * r_outer);
+        // Inner vertex
+        glVertex2f(cx + cos_theta * r_inner, cy + sin_theta * r_inner);
+    }
+    glEnd();
+}
+}
+
+void DrawRings(const RingInstance* rings, int count, ImVec4 color1, ImVec4 color2,
+               int segments, float theta_rotation, ShapeRenderMode mode) {
+    PROFILE_ZONE("DrawRings");
+    if (count <= 0) return;
+
+    if (mode == SHAPE_RENDER_SDF && ShapeShaderAvailable()) {
+        shapes.resize(count);
+        for (int i = 0; i < count; ++i) {
+            const RingInstance& r = rings[i];
+            shapes[i] = { r.cx, r.cy, r.radius, r.radius * r.inner_ratio, theta_rotation + r.rotation,
+                          (float)segments, 1.0f, color1, color2 };
+        }
+        DrawShapes(shapes.data(), count);
+        return;
+    }
+
+    if (!initialized) init();
+    if (mode == SHAPE_RENDER_IMMEDIATE || !supported) {
+        for (int i = 0; i < count; ++i) {
+            const RingInstance& r = rings[i];
+            draw_filled_ring(r.cx, r.cy, r.radius, r.radius * r.inner_ratio, color1, color2,
+                             segments, theta_rotation + r.rotation);
+        }
+        return;
+    }
+
+    if (segments != mesh_segments) build_mesh(segments);
+
+    glUseProgram(program);
+    glUniform1f(theta_loc, theta_rotation);
+    glUniform4f(color1_loc, color1.x, color1.y, color1.z, color1.w);
+    glUniform4f(color2_loc, color2.x, color2.y, color2.z, color2.w);
+
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(RingInstance), rings, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(RingInstance), (void*)0);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(RingInstance), (void*)(4 * sizeof(float)));
+    glVertexAttribDivisor(2, 1);
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 2 * (segments + 1), count);
+
+    glVertexAttribDivisor(1, 0);
+    glVertexAttribDivisor(2, 0);
+    glDisableVertexAttribArray(0);
+    glDisableVertexAttribArray(1);
+    glDisableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
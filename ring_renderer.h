@@ -0,0 +1,18 @@
+#pragma once
+#include "imgui.h"
+#include "shape_renderer.h"
+
+// One tracked-object ring, in spotlight window pixels
+struct RingInstance {
+    float cx, cy;
+    float radius;       // outer radius
+    float inner_ratio;  // inner radius / outer radius
+    float rotation;     // added to the shared theta rotation
+};
+
+// Draw every ring with the shared colours, segment count and rotation.
+// Instanced mode draws a static unit-ring mesh once per ring and SDF mode one
+// quad per ring, each in a single draw call; both fall back to immediate mode
+// if the GL lacks instancing.
+void DrawRings(const RingInstance* rings, int count, ImVec4 color1, ImVec4 color2,
+               int segments, float theta_rotation, ShapeRenderMode mode);
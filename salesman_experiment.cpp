@@ -1,9 +1,10 @@
 #include "salesman_experiment.h"
+#include "profiler.h"
 #include "serial/serial.h"
 #include "pump_controls.h"
-#include "spotlight_controls.h"
 #include <imgui.h>
 #include <GLFW/glfw3.h>
+#include <atomic>
 #include <vector>
 #include <random>
 #include <algorithm>
@@ -17,47 +18,53 @@ struct SalesmanCircle {
     bool intersecting = false;
 };
 
-static std::vector<SalesmanCircle> circles;
 static int num_circles = 5;
 static float circle_radius = 70.0f;
 static int intersection_time_ms = 500;
 static bool pump_check[3] = {false, false, false};
-static bool experiment_running = false;
-static double experiment_start_time = 0.0;
 static unsigned int user_seed = 0; // User-configurable seed (0 = auto-generate)
 static unsigned int current_seed = 0; // The actual seed used for current experiment
 static bool reuse_last_seed = false; // Checkbox to reuse the last seed
-static std::mt19937 rng;
+static uint32_t restart_count = 0;
 
 // User-configurable color and segments for salesman circles
 static ImVec4 salesman_circle_color = ImVec4(1.0f, 0.8f, 0.2f, 1.0f);
 static int salesman_circle_segments = 5;
-ImVec4& RefSalesmanCircleColor() { return salesman_circle_color; }
-int& RefSalesmanCircleSegments() { return salesman_circle_segments; }
 
-void RestartSalesmanExperiment() {
-    circles.clear();
-    
-    // Set the seed for this experiment
+// Experiment state, owned by the render thread. The UI only reads the two
+// atomics.
+static std::vector<SalesmanCircle> circles;
+static std::atomic<bool> experiment_running{false};
+static std::atomic<int> circles_remaining{0};
+static double experiment_start_time = 0.0;
+static uint32_t applied_restart_count = 0;
+static std::mt19937 rng;
+
+static void RequestRestart() {
+    // Resolve the seed here so the panel can show it straight away
     if (reuse_last_seed && current_seed != 0) {
         // Reuse the last seed
-        rng.seed(current_seed);
     } else if (user_seed == 0) {
         // Auto-generate seed from current time
         current_seed = (unsigned)std::chrono::system_clock::now().time_since_epoch().count();
-        rng.seed(current_seed);
     } else {
         // Use user-specified seed
         current_seed = user_seed;
-        rng.seed(current_seed);
     }
+    restart_count++;
+}
+
+static void RestartSalesmanExperiment(const SalesmanParams& params, double time) {
+    circles.clear();
+    circles.reserve(params.num_circles);
+    rng.seed(params.seed);
     
     std::uniform_real_distribution<float> xdist(0.1f, 0.9f);
     std::uniform_real_distribution<float> ydist(0.1f, 0.9f);
     
-    for (int i = 0; i < num_circles; ++i) {
+    for (int i = 0; i < params.num_circles; ++i) {
         SalesmanCircle c;
-        c.radius = circle_radius;
+        c.radius = params.circle_radius;
         c.collected = false;
         c.intersect_start = 0.0;
         c.intersecting = false;
@@ -96,8 +103,9 @@ void RestartSalesmanExperiment() {
         // This handles cases where there's not enough space for all circles
         circles.push_back(c);
     }
+    circles_remaining = (int)circles.size();
     experiment_running = true;
-    experiment_start_time = ImGui::GetTime();
+    experiment_start_time = time;
 }
 
 bool IsSalesmanExperimentRunning() {
@@ -105,6 +113,7 @@ bool IsSalesmanExperimentRunning() {
 }
 
 void RenderSalesmanExperimentControls() {
+    PROFILE_ZONE("RenderSalesmanExperimentControls");
     if (ImGui::Begin("Salesman Experiment")) {
         ImGui::SliderInt("Number of Circles", &num_circles, 1, 20);
         ImGui::SliderFloat("Circle Radius (px)", &circle_radius, 5.0f, 200.0f);
@@ -125,47 +134,88 @@ void RenderSalesmanExperimentControls() {
         ImGui::Checkbox("Pump Y", &pump_check[1]); ImGui::SameLine();
         ImGui::Checkbox("Pump Z", &pump_check[2]);
         if (ImGui::Button("Restart Experiment")) {
-            RestartSalesmanExperiment();
+            RequestRestart();
         }
         if (!experiment_running) {
             if (ImGui::Button("Start Experiment")) {
-                RestartSalesmanExperiment();
+                RequestRestart();
             }
         }
-        ImGui::Text("Circles remaining: %d", (int)std::count_if(circles.begin(), circles.end(), [](const SalesmanCircle& c){return !c.collected;}));
+        ImGui::Text("Circles remaining: %d", circles_remaining.load());
     }
     ImGui::End();
 }
 
-void DrawSalesmanExperiment(int width, int height, double /*time*/) {
+SalesmanParams GetSalesmanParams() {
+    SalesmanParams p;
+    p.num_circles = num_circles;
+    p.circle_radius = circle_radius;
+    p.intersection_time_ms = intersection_time_ms;
+    for (int i = 0; i < 3; ++i) {
+        p.pump_check[i] = pump_check[i];
+        p.pumps[i].push = get_pump_is_push(i);
+        p.pumps[i].control_mode = get_pump_control_mode(i);
+        p.pumps[i].microliters = get_pump_microliters(i);
+        p.pumps[i].delivery_ms = get_pump_delivery_ms(i);
+        p.pumps[i].cycles = get_pump_cycles(i);
+        p.pumps[i].delays = get_pump_delays(i);
+    }
+    p.circle_color = salesman_circle_color;
+    p.circle_segments = salesman_circle_segments;
+    p.seed = current_seed;
+    p.restart_count = restart_count;
+    return p;
+}
+
+void DrawSalesmanExperiment(const SalesmanParams& params, ShapeRenderMode mode, int width, int height, double time) {
+    PROFILE_ZONE("DrawSalesmanExperiment");
+    if (params.restart_count != applied_restart_count) {
+        applied_restart_count = params.restart_count;
+        RestartSalesmanExperiment(params, time);
+    }
     if (!experiment_running) return;
+    if (mode == SHAPE_RENDER_SDF && ShapeShaderAvailable()) {
+        static std::vector<ShapeInstance> shapes;
+        shapes.clear();
+        for (const auto& c : circles) {
+            if (c.collected) continue;
+            shapes.push_back({ c.center.x * width, c.center.y * height, c.radius, 0.0f, 0.0f,
+                               (float)params.circle_segments, (float)params.circle_segments,
+                               params.circle_color, params.circle_color });
+        }
+        DrawShapes(shapes.data(), (int)shapes.size());
+        return;
+    }
     for (const auto& c : circles) {
         if (c.collected) continue;
         float px = c.center.x * width;
         float py = c.center.y * height;
-        glColor4f(salesman_circle_color.x, salesman_circle_color.y, salesman_circle_color.z, salesman_circle_color.w);
+        glColor4f(params.circle_color.x, params.circle_color.y, params.circle_color.z, params.circle_color.w);
         glBegin(GL_TRIANGLE_FAN);
         glVertex2f(px, py);
-        for (int j = 0; j <= salesman_circle_segments; ++j) {
-            float theta = 2.0f * 3.1415926f * j / salesman_circle_segments;
+        for (int j = 0; j <= params.circle_segments; ++j) {
+            float theta = 2.0f * 3.1415926f * j / params.circle_segments;
             glVertex2f(px + cosf(theta) * c.radius, py + sinf(theta) * c.radius);
         }
         glEnd();
     }
 }
 
-void UpdateSalesmanExperiment(int width, int height, double time, const std::vector<std::pair<ImVec2, float>>& ring_list, SerialPort& serial, const char* pump_ids) {
-    if (!experiment_running) return;
+bool UpdateSalesmanExperiment(const SalesmanParams& params, int width, int height, double time,
+                              const float* ring_x, const float* ring_y, int ring_count, float ring_radius,
+                              SerialPort& serial, const char* pump_ids) {
+    PROFILE_ZONE("UpdateSalesmanExperiment");
+    if (!experiment_running) return false;
     for (auto& c : circles) {
         if (c.collected) continue;
         float px = c.center.x * width;
         float py = c.center.y * height;
         bool any_intersect = false;
-        for (const auto& ring : ring_list) {
-            float dx = px - ring.first.x * width;
-            float dy = py - ring.first.y * height;
+        for (int i = 0; i < ring_count; ++i) {
+            float dx = px - ring_x[i];
+            float dy = py - ring_y[i];
             float dist = sqrtf(dx*dx + dy*dy);
-            if (fabs(dist - ring.second) < c.radius) {
+            if (fabs(dist - ring_radius) < c.radius) {
                 any_intersect = true;
                 break;
             }
@@ -174,29 +224,29 @@ void UpdateSalesmanExperiment(int width, int height, double time, const std::vec
             if (!c.intersecting) {
                 c.intersecting = true;
                 c.intersect_start = time;
-            } else if ((time - c.intersect_start) * 1000.0 >= intersection_time_ms) {
+            } else if ((time - c.intersect_start) * 1000.0 >= params.intersection_time_ms) {
                 c.collected = true;
+                circles_remaining--;
             }
         } else {
             c.intersecting = false;
         }
     }
     // If all collected, trigger pumps
+    bool dispensed = false;
     if (std::all_of(circles.begin(), circles.end(), [](const SalesmanCircle& c){return c.collected;})) {
         experiment_running = false;
         for (int i = 0; i < 3; ++i) {
-            if (pump_check[i]) {
-                if (get_pump_control_mode(i) == 0) {
-                    serial.send_pump_command(pump_ids[i], get_pump_is_push(i), get_pump_microliters(i), get_pump_delivery_ms(i));
+            if (params.pump_check[i]) {
+                const PumpDose& dose = params.pumps[i];
+                if (dose.control_mode == 0) {
+                    serial.send_pump_command(pump_ids[i], dose.push, dose.microliters, dose.delivery_ms);
                 } else {
-                    serial.send_pump_command(pump_ids[i], get_pump_is_push(i), get_pump_cycles(i), get_pump_delays(i));
-                }
-                // Use the exact same logic as pump_controls.cpp for dynamic circle
-                if (GetDynamicCircle()) {
-                    RefDynamicCircleStartTime() = ImGui::GetTime();
-                    RefDynamicCircleRadius() = 0.00f;
+                    serial.send_pump_command(pump_ids[i], dose.push, dose.cycles, dose.delays);
                 }
+                dispensed = true;
             }
         }
     }
+    return dispensed;
 }
@@ -1,14 +1,40 @@
 #pragma once
 #include <imgui.h>
+#include <cstdint>
 #include <vector> 
+#include "shape_renderer.h"
 class SerialPort;
 
-// User-configurable salesman experiment appearance
-ImVec4& RefSalesmanCircleColor();
-int& RefSalesmanCircleSegments();
+// Reward dose for one pump, copied from the pump panel
+struct PumpDose {
+    bool push;
+    int control_mode;  // 0 = µL over delivery_ms, 1 = cycles/delay
+    float microliters;
+    int delivery_ms;
+    int cycles;
+    int delays;
+};
+
+struct SalesmanParams {
+    int num_circles;
+    float circle_radius;
+    int intersection_time_ms;
+    bool pump_check[3];
+    PumpDose pumps[3];
+    ImVec4 circle_color;
+    int circle_segments;
+    unsigned int seed;
+    uint32_t restart_count;  // Start/Restart presses
+};
 
-void DrawSalesmanExperiment(int width, int height, double time);
 void RenderSalesmanExperimentControls();
-void RestartSalesmanExperiment();
+SalesmanParams GetSalesmanParams();
 bool IsSalesmanExperimentRunning();
-void UpdateSalesmanExperiment(int width, int height, double time, const std::vector<std::pair<ImVec2, float>>& ring_list, SerialPort& serial, const char* pump_ids);
+
+// Render thread. Draw also starts a new experiment when restart_count changes.
+void DrawSalesmanExperiment(const SalesmanParams& params, ShapeRenderMode mode, int width, int height, double time);
+// Tracked ring centers and their common radius are in window pixels.
+// Returns true when the last circle was collected and reward pumps were sent.
+bool UpdateSalesmanExperiment(const SalesmanParams& params, int width, int height, double time,
+                              const float* ring_x, const float* ring_y, int ring_count, float ring_radius,
+                              SerialPort& serial, const char* pump_ids);
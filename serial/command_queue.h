@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Bounded lock-free queue of short serial commands. Any number of threads
+// may push; one consumer pops. Each cell carries a sequence number that
+// tells producers and the consumer whose turn it is (Vyukov's bounded
+// queue), so push is a CAS and a copy, and never blocks or allocates.
+class CommandQueue {
+public:
+    static const size_t kCapacity = 256;   // power of two
+    static const size_t kMaxCommand = 64;  // bytes per command
+
+    struct Command {
+        uint32_t size;
+        int32_t tag;  // ack sequence number, or -1 if no ack is expected
+        char data[kMaxCommand];
+    };
+
+    CommandQueue() : enqueue_pos_(0), dequeue_pos_(0) {
+        for (size_t i = 0; i < kCapacity; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // False if the queue is full or the command too long
+    bool push(const char* data, size_t size, int32_t tag = -1) {
+        if (size > kMaxCommand) return false;
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & (kCapacity - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->command.size = (uint32_t)size;
+        cell->command.tag = tag;
+        std::memcpy(cell->command.data, data, size);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only
+    bool pop(Command& out) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & (kCapacity - 1)];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return false;  // empty, or the producer is mid-copy
+        out.size = cell.command.size;
+        out.tag = cell.command.tag;
+        std::memcpy(out.data, cell.command.data, out.size);
+        cell.sequence.store(pos + kCapacity, std::memory_order_release);
+        dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool empty() const {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        const Cell& cell = cells_[pos & (kCapacity - 1)];
+        return (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(pos + 1) < 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        Command command;
+    };
+
+    Cell cells_[kCapacity];
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
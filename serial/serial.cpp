@@ -1,7 +1,12 @@
 #include "serial.h"
+#include <algorithm>
 #include <fcntl.h>
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <string.h>
 #include <iostream>
@@ -14,12 +19,34 @@
 #include <dirent.h>
 #include <cstring>
 #include "json.hpp"
+#include "../profiler.h"
 #define PI 3.14159265358979323846
 using json = nlohmann::json;
 
 
-SerialPort::SerialPort() : fd_(-1) {}
-SerialPort::~SerialPort() { close(); }
+namespace {
+    // How long the I/O thread waits for a full device buffer to drain
+    // before dropping the batch
+    const int kWriteTimeoutMs = 1000;
+
+    // Swapped by the UI thread, read by whichever thread sends a volume dose
+    static std::mutex pump_configs_mutex;
+    static PumpConfigSnapshot pump_configs = std::make_shared<const std::map<char, PumpConfig> >();
+}
+
+SerialPort::SerialPort()
+    : fd_(-1), baud_rate_(0), binary_(false), next_seq_(0), io_fd_(-1), io_running_(false), io_sleeping_(false),
+      queued_(0), dropped_(0), writes_(0), bytes_(0), retries_(0), errors_(0),
+      in_flight_count_(0), ack_line_size_(0), probe_acked_(false),
+      negotiate_until_ns_(0), negotiate_timeout_ms_(0), next_probe_ns_(0), ack_stats_() {
+    memset(in_flight_, 0, sizeof(in_flight_));
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) perror("eventfd");
+}
+SerialPort::~SerialPort() {
+    close();
+    if (wake_fd_ >= 0) ::close(wake_fd_);
+}
 
 std::vector<std::string> list_json_files_in_folder() {
     const std::string folder_path = "/home/user/orange_data/config/pump";
@@ -53,7 +80,7 @@ bool load_pump_config(const std::string& filename, std::map<char, PumpConfig>& c
         json j;
         in >> j;
 
-        cfg.clear(); // make room for new config
+        config.clear(); // make room for new config
 
         for (const auto& [key, val] : j.items()) {
             char pump_id = key[0];
@@ -82,12 +109,20 @@ bool load_pump_config(const std::string& filename, std::map<char, PumpConfig>& c
 }
 
 
-const std::map<char, PumpConfig>& get_loaded_pump_configs(std::string filename) {
-    std::string user = std::getenv("USER");
-    if (!load_pump_config(filename, cfg)) {
+PumpConfigSnapshot get_loaded_pump_configs(std::string filename) {
+    std::shared_ptr<std::map<char, PumpConfig> > loaded = std::make_shared<std::map<char, PumpConfig> >();
+    if (!load_pump_config(filename, *loaded)) {
         std::cerr << "failed to load config\n";
+        return nullptr;
     }
-    return cfg;
+    std::lock_guard<std::mutex> lock(pump_configs_mutex);
+    pump_configs = loaded;
+    return pump_configs;
+}
+
+PumpConfigSnapshot get_current_pump_configs() {
+    std::lock_guard<std::mutex> lock(pump_configs_mutex);
+    return pump_configs;
 }
 
 void initialize_pump_state_from_config(const std::map<char, PumpConfig>& configs,
@@ -117,49 +152,322 @@ void initialize_pump_state_from_config(const std::map<char, PumpConfig>& configs
 }
 
 bool SerialPort::open(const std::string& port_name, int baud_rate) {
-    fd_ = ::open(port_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
-    if (fd_ < 0) return false;
-
-    struct termios tty {};
-    if (tcgetattr(fd_, &tty) != 0) return false;
-
-    cfsetospeed(&tty, B9600);
-    cfsetispeed(&tty, B9600);
-
-    tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8;
-    tty.c_iflag = tty.c_oflag = tty.c_lflag = 0;
-    tty.c_cc[VMIN] = 1;
-    tty.c_cc[VTIME] = 1;
+    close();
+    int fd = ::open(port_name.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) return false;
 
-    if (tcsetattr(fd_, TCSANOW, &tty) != 0) return false;
+    if (wake_fd_ < 0 || !ConfigureSerialPort(fd, baud_rate)) {
+        ::close(fd);
+        return false;
+    }
 
+    // A producer racing the last close() may have queued after the final
+    // flush; that command was meant for the old device
+    discard_queued();
+    io_fd_ = fd;
+    port_name_ = port_name;
+    baud_rate_ = baud_rate;
+    binary_ = false;  // opening resets the Arduino, which boots in ASCII
+    memset(in_flight_, 0, sizeof(in_flight_));
+    in_flight_count_ = 0;
+    ack_parser_.reset();
+    ack_line_size_ = 0;
+    probe_acked_ = false;
+    {
+        std::lock_guard<std::mutex> lock(ack_mutex_);
+        ack_stats_ = AckStats();
+    }
+    negotiate_until_ns_ = 0;
+    next_probe_ns_ = 0;
+    io_sleeping_ = false;
+    io_running_ = true;
+    io_thread_ = std::thread(&SerialPort::io_loop, this);
+    fd_ = fd;  // accept commands only once the I/O thread is there to send them
     return true;
 }
 
 void SerialPort::close() {
-    if (fd_ != -1) {
-        ::close(fd_);
-        fd_ = -1;
+    // Stop accepting commands first, so nothing queued from here on can
+    // go out on whatever device is opened next
+    fd_ = -1;
+    if (io_thread_.joinable()) {
+        io_running_ = false;
+        uint64_t one = 1;
+        if (::write(wake_fd_, &one, sizeof(one)) < 0) perror("eventfd write");
+        io_thread_.join();  // flushes what was already queued, through io_fd_
     }
+    negotiate_until_ns_ = 0;
+    discard_queued();
+    if (io_fd_ != -1) {
+        ::close(io_fd_);
+        io_fd_ = -1;
+    }
+}
+
+// Only while no I/O thread is running; the queue has a single consumer
+void SerialPort::discard_queued() {
+    CommandQueue::Command command;
+    while (queue_.pop(command)) dropped_.fetch_add(1, std::memory_order_relaxed);
 }
 
 bool SerialPort::is_open() const {
     return fd_ != -1;
 }
 
+bool SerialPort::is_binary() const { return binary_; }
+
+int SerialPort::baud_rate() const { return baud_rate_; }
+
+void SerialPort::negotiate_binary(int timeout_ms) {
+    if (!is_open() || binary_) return;
+    probe_acked_ = false;
+    negotiate_timeout_ms_ = timeout_ms;
+    negotiate_until_ns_ = ProfileNowNs() + (uint64_t)timeout_ms * 1000000;
+    uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0) perror("eventfd write");
+}
+
+bool SerialPort::is_negotiating() const {
+    return negotiate_until_ns_ != 0;
+}
+
+// I/O thread. Sends kBinaryProbe every 100 ms until read_acks sees the
+// hello ack or the time runs out. Returns how long the thread may sleep
+// before the next probe, or -1 when not negotiating.
+int SerialPort::probe_binary() {
+    const uint64_t kProbeIntervalNs = 100000000;
+    uint64_t until = negotiate_until_ns_;
+    if (until == 0) return -1;
+    if (probe_acked_) {
+        binary_ = true;
+        negotiate_until_ns_ = 0;
+        return -1;
+    }
+    uint64_t now = ProfileNowNs();
+    if (now >= until) {
+        std::cerr << port_name_ << ": no binary protocol ack within " << negotiate_timeout_ms_
+                  << " ms, staying on ASCII" << std::endl;
+        negotiate_until_ns_ = 0;
+        return -1;
+    }
+    if (now >= next_probe_ns_) {
+        // A full device buffer just skips this probe; the next one follows
+        if (::write(io_fd_, kBinaryProbe, sizeof(kBinaryProbe) - 1) < 0 && errno != EAGAIN) perror("serial probe");
+        next_probe_ns_ = now + kProbeIntervalNs;
+    }
+    return (int)((std::min(next_probe_ns_, until) - now) / 1000000) + 1;
+}
+
 bool SerialPort::write(const std::string& data) {
-    if (!is_open()) return false;
-    return ::write(fd_, data.c_str(), data.size()) > 0;
+    return write(data.c_str(), data.size());
+}
+
+bool SerialPort::write(const char* data, size_t size) {
+    return enqueue(data, size, -1);
+}
+
+bool SerialPort::enqueue(const char* data, size_t size, int32_t tag) {
+    PROFILE_ZONE("SerialPort::write");
+    if (!is_open() || !queue_.push(data, size, tag)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    queued_.fetch_add(1, std::memory_order_relaxed);
+
+    // Pairs with the fence in io_loop: either the I/O thread sees the
+    // command before it sleeps, or we see it asleep and wake it. The
+    // eventfd write is a syscall, so skip it while the thread is awake.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (io_sleeping_.load(std::memory_order_relaxed) && io_sleeping_.exchange(false)) {
+        uint64_t one = 1;
+        if (::write(wake_fd_, &one, sizeof(one)) < 0) perror("eventfd write");
+    }
+    return true;
+}
+
+SerialPort::Stats SerialPort::stats() const {
+    Stats s;
+    s.queued = queued_.load(std::memory_order_relaxed);
+    s.dropped = dropped_.load(std::memory_order_relaxed);
+    s.writes = writes_.load(std::memory_order_relaxed);
+    s.bytes = bytes_.load(std::memory_order_relaxed);
+    s.retries = retries_.load(std::memory_order_relaxed);
+    s.errors = errors_.load(std::memory_order_relaxed);
+    return s;
+}
+
+SerialPort::AckStats SerialPort::ack_stats() const {
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    return ack_stats_;
+}
+
+void SerialPort::io_loop() {
+    SetProfilerThreadName("serial");
+    CommandQueue::Command batch[kMaxBatch];
+
+    while (true) {
+        int probe_timeout_ms = probe_binary();
+
+        // Everything queued since the last wakeup goes out in one writev
+        int count = 0;
+        while (count < kMaxBatch && queue_.pop(batch[count])) ++count;
+        if (count > 0) {
+            write_batch(batch, count);
+            read_acks();
+            continue;
+        }
+        if (!io_running_) break;
+
+        io_sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!queue_.empty() || !io_running_) {
+            io_sleeping_.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Sleep until a command is queued or the device replies; wake up
+        // now and then while acks are outstanding to expire lost ones, and
+        // for the next probe while negotiating
+        int timeout_ms = in_flight_count_ > 0 ? 100 : -1;
+        if (probe_timeout_ms >= 0 && (timeout_ms < 0 || probe_timeout_ms < timeout_ms)) timeout_ms = probe_timeout_ms;
+        pollfd fds[2] = { { wake_fd_, POLLIN, 0 }, { io_fd_, POLLIN, 0 } };
+        if (poll(fds, 2, timeout_ms) < 0 && errno != EINTR) perror("poll serial");
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            if (::read(wake_fd_, &value, sizeof(value)) < 0 && errno != EAGAIN) perror("eventfd read");
+        }
+        io_sleeping_.store(false, std::memory_order_relaxed);
+        if (fds[1].revents & POLLIN) read_acks();
+        if (fds[1].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            // Unplugged; back off rather than spin on the dead fd
+            usleep(100000);
+        }
+        expire_acks();
+    }
+}
+
+void SerialPort::read_acks() {
+    uint8_t buf[256];
+    ssize_t n;
+    while ((n = ::read(io_fd_, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            uint8_t c = buf[i];
+
+            // Binary acks, and the hello ack to the probe in either mode
+            if (ack_parser_.feed(c) && ack_parser_.size() == 2 && ack_parser_.payload()[0] == kFrameAck) {
+                if (ack_parser_.payload()[1] == kFrameHello) probe_acked_ = true;
+                else on_ack(ack_parser_.seq());
+            }
+
+            // ASCII echoes such as "hx 120 50 #17"
+            if (binary_) continue;
+            if (c != '\n') {
+                if (ack_line_size_ < (int)sizeof(ack_line_) - 1) ack_line_[ack_line_size_++] = (char)c;
+                continue;
+            }
+            ack_line_[ack_line_size_] = '\0';
+            ack_line_size_ = 0;
+            const char* hash = strrchr(ack_line_, '#');
+            if (hash && hash[1] >= '0' && hash[1] <= '9') on_ack((uint8_t)atoi(hash + 1));
+        }
+    }
+}
+
+void SerialPort::on_ack(uint8_t seq) {
+    InFlight& f = in_flight_[seq];
+    if (!f.pending) return;  // already expired as lost, or a stray echo
+    f.pending = false;
+    in_flight_count_--;
+
+    double rtt_ms = (ProfileNowNs() - f.sent_ns) / 1e6;
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    AckStats& s = ack_stats_;
+    s.acked++;
+    if (rtt_ms > kLateAckMs) {
+        s.late++;
+        std::cerr << port_name_ << ": command #" << (int)seq << " acked late, " << rtt_ms << " ms" << std::endl;
+    }
+    s.last_rtt_ms = rtt_ms;
+    s.mean_rtt_ms += (rtt_ms - s.mean_rtt_ms) / s.acked;
+    if (rtt_ms > s.max_rtt_ms) s.max_rtt_ms = rtt_ms;
+    s.in_flight = in_flight_count_;
+}
+
+void SerialPort::expire_acks() {
+    if (in_flight_count_ == 0) return;
+    uint64_t now = ProfileNowNs();
+    uint64_t lost = 0;
+    for (int seq = 0; seq < 256; ++seq) {
+        InFlight& f = in_flight_[seq];
+        if (f.pending && now - f.sent_ns > (uint64_t)kLostAckMs * 1000000) {
+            f.pending = false;
+            in_flight_count_--;
+            lost++;
+            std::cerr << port_name_ << ": command #" << seq << " lost, no ack in " << kLostAckMs << " ms" << std::endl;
+        }
+    }
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    ack_stats_.lost += lost;
+    ack_stats_.in_flight = in_flight_count_;
+}
+
+void SerialPort::write_batch(CommandQueue::Command* batch, int count) {
+    PROFILE_ZONE("serial writev");
+    struct iovec iov[kMaxBatch];
+    for (int i = 0; i < count; ++i) {
+        iov[i].iov_base = batch[i].data;
+        iov[i].iov_len = batch[i].size;
+    }
+
+    int fd = io_fd_;
+    int first = 0;
+    while (first < count) {
+        uint64_t sent_ns = ProfileNowNs();
+        ssize_t n = ::writev(fd, iov + first, count - first);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Device buffer full (a slow baud rate or a stalled
+                // Arduino); wait for room instead of spinning
+                retries_.fetch_add(1, std::memory_order_relaxed);
+                pollfd out = { fd, POLLOUT, 0 };
+                int ready = poll(&out, 1, kWriteTimeoutMs);
+                if (ready > 0 && !(out.revents & (POLLERR | POLLHUP | POLLNVAL))) continue;
+                if (ready == 0) std::cerr << "Serial write timed out, dropping " << count - first << " commands" << std::endl;
+                else perror("serial poll");
+            } else {
+                perror("serial writev");
+            }
+            errors_.fetch_add(count - first, std::memory_order_relaxed);
+            return;
+        }
+
+        writes_.fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(n, std::memory_order_relaxed);
+        // Skip what was written; a partial write resumes mid-command
+        while (first < count && (size_t)n >= iov[first].iov_len) {
+            n -= iov[first].iov_len;
+            if (batch[first].tag >= 0) track(batch[first].tag, sent_ns);
+            ++first;
+        }
+        if (first < count) {
+            iov[first].iov_base = (char*)iov[first].iov_base + n;
+            iov[first].iov_len -= n;
+        }
+    }
 }
 
-std::string SerialPort::read() {
-    if (!is_open()) return "";
-    char buf[256];
-    int n = ::read(fd_, buf, sizeof(buf));
-    if (n > 0) {
-        return std::string(buf, n);
+void SerialPort::track(uint8_t seq, uint64_t sent_ns) {
+    InFlight& f = in_flight_[seq];
+    std::lock_guard<std::mutex> lock(ack_mutex_);
+    if (f.pending) {
+        ack_stats_.lost++;  // 256 commands later and still no ack
+    } else {
+        in_flight_count_++;
     }
-    return ""; 
+    f.pending = true;
+    f.sent_ns = sent_ns;
+    ack_stats_.in_flight = in_flight_count_;
 }
 
 std::vector<std::string> SerialPort::list_available_ports() {
@@ -175,12 +483,34 @@ std::vector<std::string> SerialPort::list_available_ports() {
         }
     }
     closedir(dev_dir);
+
+    // Simulated pumps and gates from device_sim, when it is running
+    DIR* sim_dir = opendir(kSimulatedPortDir);
+    if (sim_dir) {
+        while ((entry = readdir(sim_dir)) != nullptr) {
+            if (entry->d_name[0] == '.') continue;
+            ports.push_back(std::string(kSimulatedPortDir) + "/" + entry->d_name);
+        }
+        closedir(sim_dir);
+    }
     return ports;
 }
 
 void SerialPort::send_door_command(const std::string& command) {
     if (!is_open()) return;
 
+    if (binary_) {
+        uint8_t frame[kMaxFrameSize];
+        uint8_t seq = (uint8_t)next_seq_.fetch_add(1);
+        size_t n = EncodeDoorFrame(seq, command.data(), command.size(), frame);
+        if (n == 0) {
+            std::cerr << "Door command too long: " << command << std::endl;
+            return;
+        }
+        enqueue((const char*)frame, n, seq);
+        return;
+    }
+
     std::string full_command = command + "\n";
     write(full_command);
 }
@@ -188,9 +518,21 @@ void SerialPort::send_door_command(const std::string& command) {
 void SerialPort::send_pump_command(char pump, bool push, int cycles, int delay_us) {
     if (!is_open()) return;
 
-    std::ostringstream oss;
-    oss << (push ? 'h' : 'l') << pump << " " << cycles << " " << delay_us << "\n";
-    write(oss.str());
+    if (binary_) {
+        uint8_t frame[kMaxFrameSize];
+        uint8_t seq = (uint8_t)next_seq_.fetch_add(1);
+        size_t n = EncodePumpFrame(seq, pump, push, cycles, delay_us, frame);
+        enqueue((const char*)frame, n, seq);
+        return;
+    }
+
+    // Formatted on the stack; this runs on the render thread. pumps.ino
+    // reads the delay with toInt(), which stops at the " #seq" suffix, and
+    // echoes the whole line back as the ack.
+    uint8_t seq = (uint8_t)next_seq_.fetch_add(1);
+    char command[64];
+    int n = snprintf(command, sizeof(command), "%c%c %d %d #%u\n", push ? 'h' : 'l', pump, cycles, delay_us, (unsigned)seq);
+    enqueue(command, n, seq);
 }
 
 
@@ -198,9 +540,13 @@ void SerialPort::send_pump_command(char pump, bool push, int cycles, int delay_u
 void SerialPort::send_pump_command(char pump, bool push, float ul, int dispense_time_ms) {
     if (!is_open()) return;
 
-    std::ostringstream oss;
-
-    PumpConfig config = cfg[pump];
+    PumpConfigSnapshot configs = get_current_pump_configs();
+    std::map<char, PumpConfig>::const_iterator it = configs->find(pump);
+    if (it == configs->end()) {
+        std::cerr << "No pump config loaded for pump " << pump << std::endl;
+        return;
+    }
+    const PumpConfig& config = it->second;
 
     double lead_mm = config.lead_mm;
     int steps_per_rev = config.steps_per_rev;
@@ -217,7 +563,6 @@ void SerialPort::send_pump_command(char pump, bool push, float ul, int dispense_
 
     int delay = dispense_time_ms * 1000 / pulse_count;
     
-    oss << (push ? 'h' : 'l') << pump << " " << pulse_count << " " << delay << "\n";
-    write(oss.str());
+    send_pump_command(pump, push, pulse_count, delay);
 
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #pragma once
 
+#include "command_queue.h"
+#include "serial_protocol.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <thread>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
 
 struct PumpConfig {
     float target_uL;
@@ -19,11 +26,17 @@ struct PumpConfig {
     int repeat_delay;
 };
 
-static std::map<char, PumpConfig> cfg;
+// The loaded pump configs are swapped whole, never edited in place, so the
+// scheduler and render threads can keep using a snapshot while the UI
+// loads another file.
+typedef std::shared_ptr<const std::map<char, PumpConfig> > PumpConfigSnapshot;
 
 std::vector<std::string> list_json_files_in_folder();
 bool load_pump_config(const std::string& filename, std::map<char, PumpConfig>& config);
-const std::map<char, PumpConfig>& get_loaded_pump_configs(std::string filename);
+// Loads filename and makes it the current snapshot; nullptr if it fails to
+// load, in which case the previous snapshot stays current
+PumpConfigSnapshot get_loaded_pump_configs(std::string filename);
+PumpConfigSnapshot get_current_pump_configs();
 void initialize_pump_state_from_config(const std::map<char, PumpConfig>& configs,
     const char pump_ids[],
     float microliters[3],
@@ -35,6 +48,10 @@ void initialize_pump_state_from_config(const std::map<char, PumpConfig>& configs
     bool repeat[3],
     int repeat_delay[3]);
 
+// Writes go through a per-port I/O thread, started by open() and stopped
+// by close(): write() only queues the bytes, so it is safe from the render
+// thread. Commands queued close together are sent with one writev. The
+// same thread reads the device's acks.
 class SerialPort {
     public:
         SerialPort();
@@ -42,12 +59,51 @@ class SerialPort {
     
         static std::vector<std::string> list_available_ports();
     
-        bool open(const std::string& port_name, int baud_rate = 9600);
+        bool open(const std::string& port_name, int baud_rate = kDefaultBaudRate);
         void close();
         bool is_open() const;
+
+        // Starts probing with kBinaryProbe until the device acks it or
+        // timeout_ms passes; allow for the ~1.6 s bootloader delay after
+        // open. Returns at once: the I/O thread sends the probes, and
+        // commands switch to binary frames once the ack arrives. They stay
+        // ASCII on a timeout, e.g. with old firmware.
+        void negotiate_binary(int timeout_ms);
+        bool is_negotiating() const;
+        bool is_binary() const;
+        int baud_rate() const;
     
+        // Non-blocking. False if the port is closed, the queue is full or
+        // the data is longer than CommandQueue::kMaxCommand.
         bool write(const std::string& data);
-        std::string read();
+        bool write(const char* data, size_t size);
+
+        struct Stats {
+            uint64_t queued;   // commands accepted by write()
+            uint64_t dropped;  // rejected: queue full or too long
+            uint64_t writes;   // writev calls that sent data
+            uint64_t bytes;
+            uint64_t retries;  // EAGAIN waits for the device to drain
+            uint64_t errors;   // commands lost to write errors or timeouts
+        };
+        Stats stats() const;
+
+        // Round trip from writev to the device's ack. Pump commands carry a
+        // sequence number, " #seq" on ASCII lines (pumps.ino echoes the line)
+        // or the frame seq in binary; door commands only in binary, since
+        // the ASCII door protocol has no reply. pumps.ino acks a dispense
+        // when it is queued, not when it runs, so step time stays out of
+        // the RTT; a full queue (7 waiting) sends no ack and counts as lost.
+        static const int kLateAckMs = 50;
+        static const int kLostAckMs = 2000;
+        struct AckStats {
+            uint64_t acked;
+            uint64_t late;  // acked after kLateAckMs
+            uint64_t lost;  // no ack within kLostAckMs
+            int in_flight;
+            double last_rtt_ms, mean_rtt_ms, max_rtt_ms;
+        };
+        AckStats ack_stats() const;
     
         void send_pump_command(char pump, bool push, int cycles, int delay_us);
 
@@ -56,5 +112,46 @@ class SerialPort {
         void send_door_command(const std::string& command);
 
     private:
-        int fd_;
+        static const int kMaxBatch = 32;  // commands per writev
+
+        bool enqueue(const char* data, size_t size, int32_t tag);
+        void io_loop();
+        void write_batch(CommandQueue::Command* batch, int count);
+        void track(uint8_t seq, uint64_t sent_ns);
+        void read_acks();
+        void on_ack(uint8_t seq);
+        void expire_acks();
+        void discard_queued();
+        int probe_binary();
+
+        std::atomic<int> fd_;  // -1 once closing, so producers stop queueing
+        int baud_rate_;
+        std::atomic<bool> binary_;
+        std::atomic<unsigned> next_seq_;  // frame sequence number, low byte on the wire
+        int io_fd_;    // the I/O thread's copy of fd_, still valid for the final flush
+        int wake_fd_;  // eventfd, signalled when a command is queued for a sleeping I/O thread;
+                       // lives as long as the object, so a producer never writes to a reused fd
+        std::thread io_thread_;
+        std::atomic<bool> io_running_;
+        std::atomic<bool> io_sleeping_;
+        CommandQueue queue_;
+        std::atomic<uint64_t> queued_, dropped_, writes_, bytes_, retries_, errors_;
+
+        // Ack matching; I/O thread only except where noted
+        struct InFlight {
+            uint64_t sent_ns;
+            bool pending;
+        };
+        std::string port_name_;
+        InFlight in_flight_[256];  // by seq
+        int in_flight_count_;
+        FrameParser ack_parser_;
+        char ack_line_[64];
+        int ack_line_size_;
+        std::atomic<bool> probe_acked_;  // set here, polled by probe_binary
+        std::atomic<uint64_t> negotiate_until_ns_;  // 0 when not negotiating
+        std::atomic<int> negotiate_timeout_ms_;
+        uint64_t next_probe_ns_;
+        mutable std::mutex ack_mutex_;   // guards ack_stats_ for the UI
+        AckStats ack_stats_;
 };
\ No newline at end of file
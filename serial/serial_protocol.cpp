@@ -0,0 +1,136 @@
+#include "serial_protocol.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+const int kBaudRates[kBaudRateCount] = {
+    9600, 19200, 38400, 57600, 115200, 230400, 460800, 500000, 921600, 1000000
+};
+const char* const kBaudRateLabels[kBaudRateCount] = {
+    "9600", "19200", "38400", "57600", "115200", "230400", "460800", "500000", "921600", "1000000"
+};
+
+int DefaultBaudRateIndex() {
+    for (int i = 0; i < kBaudRateCount; ++i) {
+        if (kBaudRates[i] == kDefaultBaudRate) return i;
+    }
+    return kBaudRateCount - 1;
+}
+
+uint16_t Crc16(const uint8_t* data, size_t size, uint16_t crc) {
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+size_t EncodeFrame(uint8_t seq, const uint8_t* payload, size_t size, uint8_t* out) {
+    if (size > (size_t)kMaxFramePayload) return 0;
+    out[0] = kFrameSync;
+    out[1] = (uint8_t)size;
+    out[2] = seq;
+    memcpy(out + 3, payload, size);
+    uint16_t crc = Crc16(out + 1, size + 2);
+    out[3 + size] = (uint8_t)(crc & 0xFF);
+    out[4 + size] = (uint8_t)(crc >> 8);
+    return size + kFrameOverhead;
+}
+
+static void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+size_t EncodePumpFrame(uint8_t seq, char pump, bool push, uint32_t cycles, uint32_t delay_us, uint8_t* out) {
+    uint8_t payload[11];
+    payload[0] = kFramePump;
+    payload[1] = (uint8_t)pump;
+    payload[2] = push ? 'h' : 'l';
+    put_u32(payload + 3, cycles);
+    put_u32(payload + 7, delay_us);
+    return EncodeFrame(seq, payload, sizeof(payload), out);
+}
+
+size_t EncodeDoorFrame(uint8_t seq, const char* pairs, size_t size, uint8_t* out) {
+    uint8_t payload[kMaxFramePayload];
+    if (size + 1 > sizeof(payload)) return 0;
+    payload[0] = kFrameDoor;
+    memcpy(payload + 1, pairs, size);
+    return EncodeFrame(seq, payload, size + 1, out);
+}
+
+FrameParser::FrameParser() : crc_errors_(0) { reset(); }
+
+void FrameParser::reset() { have_ = -1; }
+
+bool FrameParser::feed(uint8_t byte) {
+    if (have_ < 0) {
+        if (byte == kFrameSync) have_ = 0;
+        return false;
+    }
+    if (have_ == 0 && byte > kMaxFramePayload) {
+        // Not a length: this sync byte was noise
+        have_ = (byte == kFrameSync) ? 0 : -1;
+        return false;
+    }
+    buffer_[have_++] = byte;
+    int total = buffer_[0] + 4;  // len, seq, payload, crc16
+    if (have_ < total) return false;
+
+    have_ = -1;
+    uint16_t crc = Crc16(buffer_, total - 2);
+    if ((crc & 0xFF) != buffer_[total - 2] || (crc >> 8) != buffer_[total - 1]) {
+        crc_errors_++;
+        return false;
+    }
+    return true;
+}
+
+bool BaudRateConstant(int baud_rate, speed_t& speed) {
+    switch (baud_rate) {
+        case 9600: speed = B9600; return true;
+        case 19200: speed = B19200; return true;
+        case 38400: speed = B38400; return true;
+        case 57600: speed = B57600; return true;
+        case 115200: speed = B115200; return true;
+        case 230400: speed = B230400; return true;
+        case 460800: speed = B460800; return true;
+        case 500000: speed = B500000; return true;
+        case 921600: speed = B921600; return true;
+        case 1000000: speed = B1000000; return true;
+        default: return false;
+    }
+}
+
+bool ConfigureSerialPort(int fd, int baud_rate) {
+    speed_t speed;
+    if (!BaudRateConstant(baud_rate, speed)) {
+        std::cerr << "Unsupported baud rate " << baud_rate << std::endl;
+        return false;
+    }
+
+    struct termios tty {};
+    if (tcgetattr(fd, &tty) != 0) {
+        perror("tcgetattr");
+        return false;
+    }
+
+    cfsetospeed(&tty, speed);
+    cfsetispeed(&tty, speed);
+
+    tty.c_cflag = (tty.c_cflag & ~(CSIZE | PARENB | CSTOPB)) | CS8 | CLOCAL | CREAD;
+    tty.c_iflag = tty.c_oflag = tty.c_lflag = 0;
+    tty.c_cc[VMIN] = 1;
+    tty.c_cc[VTIME] = 1;
+
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        perror("tcsetattr");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <termios.h>
+
+// Wire formats shared by SerialPort, serial_bench and the firmware in
+// arduino/. The firmware carries its own copy of the CRC and framing;
+// keep them in step.
+//
+// Binary frame: 0xA5 | len | seq | payload[len] | crc16 (little endian)
+// crc16 is CRC-16/CCITT-FALSE over len, seq and payload.
+//
+// Payloads, host to device:
+//   'H'                                   hello; the device acks it
+//   'P' pump dir cycles:u32 delay_us:u32  pump ('x'..'a'), dir 'h' push / 'l' pull
+//   'D' pairs...                          door pairs as in ASCII, e.g. "o1c2"
+// Device to host:
+//   'A' type                              ack for the frame with the same seq
+//
+// Both sketches start in ASCII. Sending kBinaryProbe switches them to
+// binary and they answer with an ack to 'H'. Older firmware ignores it
+// (pumps.ino echoes it), so no ack means stay on ASCII.
+
+const uint8_t kFrameSync = 0xA5;
+const int kMaxFramePayload = 32;
+const int kFrameOverhead = 5;  // sync, len, seq, crc16
+const int kMaxFrameSize = kMaxFramePayload + kFrameOverhead;
+const char kBinaryProbe[] = "~~\n";
+
+const uint8_t kFrameHello = 'H';
+const uint8_t kFramePump = 'P';
+const uint8_t kFrameDoor = 'D';
+const uint8_t kFrameAck = 'A';
+
+// Rates offered in the port panels; the firmware runs at kDefaultBaudRate
+extern const int kBaudRates[];
+extern const char* const kBaudRateLabels[];
+const int kBaudRateCount = 10;
+const int kDefaultBaudRate = 1000000;
+int DefaultBaudRateIndex();  // of kDefaultBaudRate in kBaudRates
+
+// device_sim links its pty ports here; list_available_ports lists them
+const char kSimulatedPortDir[] = "/tmp/spotlight-sim";
+
+uint16_t Crc16(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF);
+
+// Frame writers return the frame size, or 0 if the payload does not fit.
+// out must hold kMaxFrameSize bytes.
+size_t EncodeFrame(uint8_t seq, const uint8_t* payload, size_t size, uint8_t* out);
+size_t EncodePumpFrame(uint8_t seq, char pump, bool push, uint32_t cycles, uint32_t delay_us, uint8_t* out);
+size_t EncodeDoorFrame(uint8_t seq, const char* pairs, size_t size, uint8_t* out);
+
+// Byte-at-a-time frame reader; skips anything that is not a valid frame,
+// such as ASCII echoes
+class FrameParser {
+public:
+    FrameParser();
+    void reset();
+
+    // True when byte completes a frame with a good CRC
+    bool feed(uint8_t byte);
+
+    uint8_t seq() const { return buffer_[1]; }
+    const uint8_t* payload() const { return buffer_ + 2; }
+    int size() const { return buffer_[0]; }
+    uint64_t crc_errors() const { return crc_errors_; }
+
+private:
+    uint8_t buffer_[kMaxFrameSize];  // len, seq, payload, crc
+    int have_;                       // bytes since sync, -1 while hunting for sync
+    uint64_t crc_errors_;
+};
+
+// termios speed for a baud rate; false if the rate is not supported
+bool BaudRateConstant(int baud_rate, speed_t& speed);
+
+// Raw 8N1 at baud_rate. False with a message if the rate is unsupported or
+// the fd is not a terminal.
+bool ConfigureSerialPort(int fd, int baud_rate);
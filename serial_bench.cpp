@@ -0,0 +1,171 @@
+// Command-to-ack latency of the ASCII and binary serial protocols.
+//
+//   serial_bench <port> [--device pumps|gates] [--baud 1000000] [--count 500]
+//
+// Opens the port, waits out the Arduino bootloader, then sends one command
+// at a time and times the reply. The pump commands run zero cycles and the
+// door command closes gate 1, so nothing moves on a rig at rest. ASCII is
+// timed against the pumps.ino echo; gates.ino has no ASCII reply, so only
+// its binary protocol is timed. Then both boards are switched to binary
+// with kBinaryProbe and timed against the acks.
+#include "serial_protocol.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+const int kReplyTimeoutMs = 500;
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool write_all(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0) {
+            pollfd out = { fd, POLLOUT, 0 };
+            if (poll(&out, 1, kReplyTimeoutMs) <= 0) return false;
+            continue;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Reads until done() accepts a byte or the deadline passes
+template <typename Done>
+bool read_until(int fd, uint64_t deadline_ns, Done done) {
+    while (true) {
+        uint64_t now = monotonic_ns();
+        if (now >= deadline_ns) return false;
+        pollfd in = { fd, POLLIN, 0 };
+        if (poll(&in, 1, (int)((deadline_ns - now) / 1000000) + 1) <= 0) continue;
+        uint8_t buf[256];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        for (ssize_t i = 0; i < n; ++i) {
+            if (done(buf[i])) return true;
+        }
+    }
+}
+
+void report(const char* name, std::vector<double>& rtt_us, int lost, size_t command_bytes, size_t reply_bytes) {
+    if (rtt_us.empty()) {
+        printf("%-8s no replies (%d lost)\n", name, lost);
+        return;
+    }
+    std::sort(rtt_us.begin(), rtt_us.end());
+    size_t n = rtt_us.size();
+    printf("%-8s %6zu %6d %8zu %8zu %9.1f %9.1f %9.1f %9.1f\n", name, n, lost, command_bytes, reply_bytes,
+           rtt_us[n / 2], rtt_us[n * 9 / 10], rtt_us[std::min(n - 1, n * 99 / 100)], rtt_us[n - 1]);
+}
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        fprintf(stderr, "usage: %s <port> [--device pumps|gates] [--baud 1000000] [--count 500]\n", argv[0]);
+        return 1;
+    }
+    const char* port = argv[1];
+    bool pumps = true;
+    int baud = kDefaultBaudRate;
+    int count = 500;
+    for (int i = 2; i < argc; ++i) {
+        if (!strcmp(argv[i], "--device") && i + 1 < argc) {
+            pumps = strcmp(argv[++i], "gates") != 0;
+        } else if (!strcmp(argv[i], "--baud") && i + 1 < argc) {
+            baud = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--count") && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s <port> [--device pumps|gates] [--baud 1000000] [--count 500]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fd = open(port, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) {
+        perror(port);
+        return 1;
+    }
+    if (!ConfigureSerialPort(fd, baud)) return 1;
+
+    // Opening the port resets the Arduino; the bootloader holds it ~1.6 s
+    usleep(2000000);
+    tcflush(fd, TCIOFLUSH);
+
+    printf("%s at %d baud, %d commands\n", port, baud, count);
+    printf("%-8s %6s %6s %8s %8s %9s %9s %9s %9s\n", "protocol", "acked", "lost", "cmd B", "reply B",
+           "p50 us", "p90 us", "p99 us", "max us");
+
+    if (pumps) {
+        const char command[] = "hx 0 0\n";
+        const std::string echo = "hx 0 0";
+        std::vector<double> rtt_us;
+        int lost = 0;
+        for (int i = 0; i < count; ++i) {
+            std::string line;
+            uint64_t start = monotonic_ns();
+            write_all(fd, command, sizeof(command) - 1);
+            bool ok = read_until(fd, start + kReplyTimeoutMs * 1000000ull, [&](uint8_t c) {
+                if (c != '\n') {
+                    if (c != '\r') line += (char)c;
+                    return false;
+                }
+                if (line == echo) return true;
+                line.clear();
+                return false;
+            });
+            if (ok) rtt_us.push_back((monotonic_ns() - start) / 1000.0);
+            else lost++;
+        }
+        report("ascii", rtt_us, lost, sizeof(command) - 1, echo.size() + 2);
+    }
+
+    // Probe until the firmware answers, as SerialPort::negotiate_binary does
+    FrameParser parser;
+    bool binary = false;
+    for (int attempt = 0; attempt < 20 && !binary; ++attempt) {
+        write_all(fd, kBinaryProbe, sizeof(kBinaryProbe) - 1);
+        binary = read_until(fd, monotonic_ns() + 100000000ull, [&](uint8_t c) {
+            return parser.feed(c) && parser.size() == 2 && parser.payload()[1] == kFrameHello;
+        });
+    }
+    if (!binary) {
+        printf("binary   no ack to the probe: old firmware, or the wrong baud rate\n");
+        close(fd);
+        return 0;
+    }
+
+    std::vector<double> rtt_us;
+    int lost = 0;
+    size_t frame_size = 0;
+    for (int i = 0; i < count; ++i) {
+        uint8_t seq = (uint8_t)i;
+        uint8_t frame[kMaxFrameSize];
+        frame_size = pumps ? EncodePumpFrame(seq, 'x', true, 0, 0, frame) : EncodeDoorFrame(seq, "c1", 2, frame);
+        uint64_t start = monotonic_ns();
+        write_all(fd, frame, frame_size);
+        bool ok = read_until(fd, start + kReplyTimeoutMs * 1000000ull, [&](uint8_t c) {
+            return parser.feed(c) && parser.seq() == seq && parser.size() == 2 && parser.payload()[0] == kFrameAck;
+        });
+        if (ok) rtt_us.push_back((monotonic_ns() - start) / 1000.0);
+        else lost++;
+    }
+    report("binary", rtt_us, lost, frame_size, 2 + kFrameOverhead);
+    if (parser.crc_errors() > 0) printf("%llu replies failed the CRC\n", (unsigned long long)parser.crc_errors());
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "shape_renderer.h"
+#include "profiler.h"
+#include "gl_shader.h"
+#include <cstddef>
+#include <iostream>
+
+namespace {
+const char* kShapeVertexShader = R"(
+#version 130
+in vec2 a_corner;    // unit quad, -1..1
+in vec4 a_circle;    // center x, center y, outer radius, inner radius
+in vec3 a_sectors;   // rotation, segments, sector run
+in vec4 a_color1;
+in vec4 a_color2;
+out vec2 v_local;
+flat out vec4 v_circle;
+flat out vec3 v_sectors;
+flat out vec4 v_color1;
+flat out vec4 v_color2;
+void main() {
+    // one pixel of margin so the anti-aliased edge is not clipped
+    v_local = a_corner * (a_circle.z + 1.0);
+    v_circle = a_circle;
+    v_sectors = a_sectors;
+    v_color1 = a_color1;
+    v_color2 = a_color2;
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(a_circle.xy + v_local, 0.0, 1.0);
+}
+)";
+
+const char* kShapeFragmentShader = R"(
+#version 130
+const float TWO_PI = 6.28318531;
+in vec2 v_local;
+flat in vec4 v_circle;
+flat in vec3 v_sectors;
+flat in vec4 v_color1;
+flat in vec4 v_color2;
+
+vec4 band_color(float band) {
+    return mod(band, 2.0) < 0.5 ? v_color1 : v_color2;
+}
+
+void main() {
+    float d = length(v_local);
+    float aa = max(fwidth(d), 1e-4);
+    float coverage = clamp((v_circle.z - d) / aa + 0.5, 0.0, 1.0);
+    if (v_circle.w > 0.0) coverage *= clamp((d - v_circle.w) / aa + 0.5, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+
+    // Colour bands of sector_run sectors; the last band may be partial
+    float band_width = TWO_PI / v_sectors.y * v_sectors.z;
+    float bands = ceil(v_sectors.y / v_sectors.z);
+    float a = mod(atan(v_local.y, v_local.x) - v_sectors.x, TWO_PI);
+    float band = min(floor(a / band_width), bands - 1.0);
+    float into = a - band * band_width;
+    float to_end = min(band_width, TWO_PI - band * band_width) - into;
+    float neighbour = into < to_end ? mod(band + bands - 1.0, bands) : mod(band + 1.0, bands);
+    float edge = clamp(min(into, to_end) * d / aa + 0.5, 0.0, 1.0);
+
+    vec4 color = mix(band_color(neighbour), band_color(band), edge);
+    gl_FragColor = vec4(color.rgb, color.a * coverage);
+}
+)";
+
+static bool initialized = false;
+static bool supported = false;
+static GLuint program = 0;
+static GLuint quad_vbo = 0;
+static GLuint instance_vbo = 0;
+
+static void init() {
+    initialized = true;
+    if (!GLEW_VERSION_3_3) {
+        std::cerr << "OpenGL 3.3 instancing unavailable, SDF shapes disabled\n";
+        return;
+    }
+    const char* attributes[] = { "a_corner", "a_circle", "a_sectors", "a_color1", "a_color2" };
+    program = CompileShaderProgram("shapes", kShapeVertexShader, kShapeFragmentShader, attributes, 5);
+    if (!program) return;
+
+    const float quad[8] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+    glGenBuffers(1, &quad_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glGenBuffers(1, &instance_vbo);
+    supported = true;
+}
+
+static void instance_attribute(GLuint index, GLint size, size_t offset) {
+    glEnableVertexAttribArray(index);
+    glVertexAttribPointer(index, size, GL_FLOAT, GL_FALSE, sizeof(ShapeInstance), (void*)offset);
+    glVertexAttribDivisor(index, 1);
+}
+}
+
+bool ShapeShaderAvailable() {
+    if (!initialized) init();
+    return supported;
+}
+
+void DrawShapes(const ShapeInstance* shapes, int count) {
+    PROFILE_ZONE("DrawShapes");
+    if (count <= 0 || !ShapeShaderAvailable()) return;
+
+    glUseProgram(program);
+    glBindBuffer(GL_ARRAY_BUFFER, quad_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instance_vbo);
+    glBufferData(GL_ARRAY_BUFFER, count * sizeof(ShapeInstance), shapes, GL_STREAM_DRAW);
+    instance_attribute(1, 4, offsetof(ShapeInstance, cx));
+    instance_attribute(2, 3, offsetof(ShapeInstance, rotation));
+    instance_attribute(3, 4, offsetof(ShapeInstance, color1));
+    instance_attribute(4, 4, offsetof(ShapeInstance, color2));
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+    for (GLuint i = 1; i <= 4; ++i) glVertexAttribDivisor(i, 0);
+    for (GLuint i = 0; i <= 4; ++i) glDisableVertexAttribArray(i);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+}
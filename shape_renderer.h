@@ -0,0 +1,25 @@
+#pragma once
+#include "imgui.h"
+
+enum ShapeRenderMode {
+    SHAPE_RENDER_IMMEDIATE,  // CPU-tessellated immediate mode
+    SHAPE_RENDER_INSTANCED,  // instanced unit-ring mesh (rings only)
+    SHAPE_RENDER_SDF,        // one quad per shape, signed distance in the fragment shader
+};
+
+// A disc or ring in spotlight window pixels. Colours alternate in bands of
+// sector_run sectors out of segments around the circle, starting at rotation.
+struct ShapeInstance {
+    float cx, cy;
+    float r_outer;
+    float r_inner;     // 0 for a filled disc
+    float rotation;
+    float segments;
+    float sector_run;
+    ImVec4 color1, color2;
+};
+
+// Draw every shape as an anti-aliased quad in one instanced draw call.
+// Needs GL 3.3; check ShapeShaderAvailable() and fall back otherwise.
+void DrawShapes(const ShapeInstance* shapes, int count);
+bool ShapeShaderAvailable();
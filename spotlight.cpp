@@ -2,23 +2,34 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "shaman/shaman.h"
-#include "serial/serial.h"
+#include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <string>
 #include <algorithm>
 #include <iostream>
-#include <math.h>
-#include <thread>
-#include <mutex>
-#include <atomic>
-#include <chrono>
+#include <unistd.h>
 
 #include "pump_controls.h"
+#include "pump_scheduler.h"
 #include "door_controls.h"
 #include "spotlight_controls.h"
 #include "grating_controls.h"
 #include "concentric_circles_controls.h"
 #include "salesman_experiment.h"
+#include "box_reader.h"
+#include "latency_stats.h"
+#include "motion_predictor.h"
+#include "spotlight_renderer.h"
+#include "frame_pacing.h"
+#include "gpu_timer.h"
+#include "profiler.h"
+#include "alloc_counter.h"
+#include "calibration.h"
+#include "warp_pass.h"
+
+// The control UI only needs to feel responsive; the spotlight renders on its own thread
+const double kControlUiHz = 60.0;
 
 // Function to get monitor information
 std::vector<GLFWmonitor*> get_monitors() {
@@ -31,10 +42,6 @@ std::vector<GLFWmonitor*> get_monitors() {
     return monitors;
 }
 
-ImVec2 lerp(const ImVec2& a, const ImVec2& b, float t) {
-    return ImVec2(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
-}
-
 // Function to create a borderless window on a specific monitor
 GLFWwindow* create_borderless_window(GLFWmonitor* monitor, GLFWwindow* shared_context = nullptr) {
     const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -58,69 +65,15 @@ GLFWwindow* create_borderless_window(GLFWmonitor* monitor, GLFWwindow* shared_co
     return window;
 }
 
-void draw_filled_circle(float cx, float cy, float r, ImVec4 color, int segments = 64) {
-    glColor4f(color.x, color.y, color.z, color.w);
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(cx, cy); // center
-    for (int i = 0; i <= segments; ++i) {
-        float theta = (2.0f * 3.1415926f * float(i)) / float(segments);
-        float x = r * cosf(theta);
-        float y = r * sinf(theta);
-        glVertex2f(cx + x, cy + y);
-    }
-    glEnd();
-}
-
-void draw_filled_circle(float cx, float cy, float r, ImVec4 color1, ImVec4 color2, int segments = 64) {
-    // draw filled circle with alternating colors
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2f(cx, cy);
-    for (int i = 0; i <= segments; ++i) {
-        float theta = (2.0f * 3.1415926f * float(i)) / float(segments);
-        float x = r * cosf(theta);
-        float y = r * sinf(theta);
-        
-        if (i % 64 < 32) {
-            glColor4f(color1.x, color1.y, color1.z, color1.w);
-        } else {
-            glColor4f(color2.x, color2.y, color2.z, color2.w);
-        }
-        glVertex2f(cx + x, cy + y);
-    }
-    glEnd();
-}
-
-void draw_filled_ring(float cx, float cy, float r_inner, float r_outer,
-                      ImVec4 color1, ImVec4 color2, int segments, float theta_rotation) {
-    float angle_step = 2.0f * 3.1415926f / segments;
-
-    glBegin(GL_TRIANGLE_STRIP);
-    for (int i = 0; i <= segments; ++i) {
-        float theta = i * angle_step + theta_rotation; // Apply rotation
-        float cos_theta = cosf(theta);
-        float sin_theta = sinf(theta);
-
-        // Alternate colors
-        ImVec4 color = (i % 2 == 0) ? color1 : color2;
-        glColor4f(color.x, color.y, color.z, color.w);
-
-        // Outer vertex
-        glVertex2f(cx + cos_theta * r_outer, cy + sin_theta * r_outer);
-        // Inner vertex
-        glVertex2f(cx + cos_theta * r_inner, cy + sin_theta * r_inner);
-    }
-    glEnd();
-}
-
-int main() {
+int main(int argc, char** argv) {
     // Initialize GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW\n";
         return -1;
     }
 
+    SetProfilerThreadName("ui");
     shaman::SharedBoxQueue reader(false);
-    std::vector<shaman::Object> boxes;
 
     // Decide GL+GLSL versions
     const char* glsl_version = "#version 130";
@@ -141,6 +94,12 @@ int main() {
     glfwMakeContextCurrent(control_window);
     glfwSwapInterval(0); // disable vsync for control window to reduce latency
 
+    // Load GL entry points for the shader renderers; both windows share this context
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW\n";
+    }
+
     // Initialize Dear ImGui
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -154,56 +113,75 @@ int main() {
     GLFWwindow* spotlight_window = nullptr;
     if (has_second_monitor && GetUseSecondMonitor()) {
         spotlight_window = create_borderless_window(monitors[1], control_window);
+        SetDisplayRefreshRate(glfwGetVideoMode(monitors[1])->refreshRate);
         if (!spotlight_window) {
             std::cerr << "Failed to create spotlight window\n";
-        } else {
-            // Disable VSync on spotlight window for minimum latency
-            glfwMakeContextCurrent(spotlight_window);
-            glfwSwapInterval(0);
-            glfwMakeContextCurrent(control_window);
         }
     }
 
-    std::vector<shaman::Object> latest_boxes;
-    std::mutex box_mutex;
-
-    std::atomic<bool> running{true};
-    
-    uint64_t writer_timestamp = 0;
+    LoadRigCalibration();
+    // Warp this rig's output if a grid has been saved for it
+    std::string warp_grid = DefaultWarpGridPath();
+    if (access(warp_grid.c_str(), R_OK) == 0 && LoadWarpGrid(warp_grid)) {
+        SetWarpEnabled(true);
+    }
+    StartBoxReader(reader);
+    StartPumpScheduler(get_serial());
 
-    std::thread reader_thread;
+    // --record <file> and --replay <file> [--speed N] [--loop] drive the box stream;
+    // --trace-on-exit <file> dumps the last seconds of profiler zones at shutdown;
+    // --fail-on-alloc aborts if a render frame allocates after warm-up
+    std::string trace_on_exit;
     {
-        auto thread_func = [&]() {
-            std::vector<shaman::Object> temp;
-            while (running) {
-                // writer_timestamp = 0;
-                while (reader.pop(temp, writer_timestamp)) {
-
-
-                    std::lock_guard<std::mutex> lock(box_mutex);
-                    latest_boxes = temp;
-
-                    uint64_t now = get_time_us();
-                    // std::cout << "write - read latency: " << (now - writer_timestamp) / 1000.0 << std::endl;
-                }
+        std::string replay_path;
+        float replay_speed = 1.0f;
+        bool replay_loop = false;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--record" && i + 1 < argc) {
+                StartBoxRecording(argv[++i]);
+            } else if (arg == "--replay" && i + 1 < argc) {
+                replay_path = argv[++i];
+            } else if (arg == "--speed" && i + 1 < argc) {
+                replay_speed = (float)atof(argv[++i]);
+            } else if (arg == "--loop") {
+                replay_loop = true;
+            } else if (arg == "--trace-on-exit" && i + 1 < argc) {
+                trace_on_exit = argv[++i];
+            } else if (arg == "--fail-on-alloc") {
+                SetAllocationFailFast(true);
+            } else {
+                std::cerr << "Unknown argument: " << arg << "\n";
             }
-        };
-        reader_thread = std::thread(thread_func);
+        }
+        if (!replay_path.empty()) {
+            StartBoxReplay(replay_path, replay_speed, replay_loop);
+        }
+    }
+
+    // The render thread owns the spotlight window's context from here on
+    if (spotlight_window) {
+        int width, height;
+        glfwGetFramebufferSize(spotlight_window, &width, &height);
+        SetSpotlightFramebufferSize(width, height);
+        PublishStimulusParams(CollectStimulusParams());
+        StartSpotlightRenderer(spotlight_window);
     }
+
     // Main loop
     while (!glfwWindowShouldClose(control_window)) {
+        double frame_start = glfwGetTime();
+
         // Poll and handle events (inputs, window resize, etc.)
         glfwPollEvents();
-
-        // Copy latest boxes data IMMEDIATELY for minimum latency
-        std::vector<shaman::Object> current_frame_boxes;
-        {
-            std::lock_guard<std::mutex> lock(box_mutex);
-            current_frame_boxes = latest_boxes;
+        if (spotlight_window) {
+            // GLFW size queries are main-thread only
+            int width, height;
+            glfwGetFramebufferSize(spotlight_window, &width, &height);
+            SetSpotlightFramebufferSize(width, height);
         }
 
         // Start the Dear ImGui frame for control window
-        glfwMakeContextCurrent(control_window);
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -216,204 +194,19 @@ int main() {
             RenderGratingControls();
             RenderConcentricRingsControls();
             RenderSalesmanExperimentControls();
+            RenderBoxReaderControls();
+            RenderLatencyControls();
+            RenderObjectTrackerControls();
+            RenderMotionPredictionControls();
+            RenderFramePacingControls();
+            RenderGpuTimingControls();
+            RenderProfilerControls();
+            RenderAllocationControls();
+            RenderWarpControls();
         }
+        PublishStimulusParams(CollectStimulusParams());
+        ServiceProfileCaptures();
 
-        // get start time for rendering spotlight
-        uint64_t spotlight_timestamp = get_time_us();
-
-        // Render spotlight window FIRST for minimum latency
-        if (has_second_monitor && GetUseSecondMonitor() && spotlight_window && !glfwWindowShouldClose(spotlight_window)) {
-            glfwMakeContextCurrent(spotlight_window);
-
-            int width, height;
-            glfwGetFramebufferSize(spotlight_window, &width, &height);
-            glViewport(0, 0, width, height);
-            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT);
-
-            // Set up OpenGL state once
-            glMatrixMode(GL_PROJECTION);
-            glLoadIdentity();
-            glOrtho(0, width, height, 0, -1, 1);
-            glMatrixMode(GL_MODELVIEW);
-            glLoadIdentity();
-            glDisable(GL_DEPTH_TEST);  // Disable depth testing for 2D
-            glEnable(GL_BLEND);        // Enable blending for transparency
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-            // Draw gratings FIRST so they appear beneath everything else
-            DrawMovingGratings(width, height, ImGui::GetTime());
-            DrawConcentricRings(width, height, ImGui::GetTime());
-            DrawSalesmanExperiment(width, height, ImGui::GetTime());
-            // --- Salesman Experiment update logic ---
-            // Gather ring data from shaman (shared memory) - optimized
-            std::vector<std::pair<ImVec2, float>> ring_list;
-            ring_list.reserve(current_frame_boxes.size()); // Pre-allocate to avoid reallocations
-            const float inv_1172 = 1.0f / 1172.0f; // Cache division
-            const float width_offset = (width - height) * 0.5f; // Cache calculation
-            const float circle_radius = GetCircleRadius() * height; // Cache calculation
-            
-            for (const auto& obj : current_frame_boxes) {
-                float xcenter = obj.rect.x + obj.rect.width * 0.5f;
-                float ycenter = obj.rect.y - obj.rect.height * 0.5f;
-                float cx = (xcenter - 153.0f) * inv_1172 * height + width_offset;
-                cx = width - cx;
-                float cy = (ycenter - 460.0f) * inv_1172 * height;
-                ring_list.emplace_back(ImVec2(cx / width, cy / height), circle_radius);
-            }
-            UpdateSalesmanExperiment(width, height, ImGui::GetTime(), ring_list, get_serial(), get_pump_ids());
-
-            // Actual central circle position in pixels
-            ImVec2 central_pixel_pos = ImVec2(
-                RefCentralCircleCenter().x * width,
-                RefCentralCircleCenter().y * height
-            );
-            float central_pixel_radius = GetCentralCircleRadius() * std::min(width, height);
-
-            // Accumulated push vector
-            ImVec2 total_push = ImVec2(0, 0);
-            
-            if (!IsManualOverride() && current_frame_boxes.size() != RefPrevCount() && current_frame_boxes.size() >= GetObjectLimit() && IsDoorSerialOpen()) {
-                std::cout << "Sending door command to close all doors" << std::endl;
-                SendDoorCommand("c1c2c3");
-            } else if (!IsManualOverride() && current_frame_boxes.size() != RefPrevCount() && current_frame_boxes.size() < GetObjectLimit() && IsDoorSerialOpen()) {
-                std::cout << "Sending door command to open all doors" << std::endl;
-                SendDoorCommand("o1o2o3");
-            }
-            RefPrevCount() = current_frame_boxes.size();
-            
-            float xcenter, ycenter;
-            for (const auto& obj : current_frame_boxes) {
-                xcenter = obj.rect.x + obj.rect.width / 2.0f;
-                ycenter = obj.rect.y - obj.rect.height / 2.0f;
-                float cx = (xcenter - GetCalibrationOffsetX()) / GetCalibrationScale() * height + (width - height) / 2;
-                cx = width - cx; // reflect so projection shows up correctly
-                float cy = (ycenter - GetCalibrationOffsetY()) / GetCalibrationScale() * height;
-                float radius = GetCircleRadius() * height;
-                if (GetCollisionEnabled()) {
-                    // Calculate vector between centers
-                    float dx = central_pixel_pos.x - cx;
-                    float dy = central_pixel_pos.y - cy;
-                    float dist_sq = dx * dx + dy * dy;
-                    float min_dist = central_pixel_radius + radius;
-
-                    if (dist_sq < min_dist * min_dist && dist_sq > 0.0f) {
-                        float dist = std::sqrt(dist_sq);
-                        float push_strength = (min_dist - dist) * 0.5f; // Push half the overlap
-                        total_push.x += (dx / dist) * push_strength;
-                        total_push.y += (dy / dist) * push_strength;
-                    }
-
-                }
-                
-                draw_filled_ring(cx, cy, radius, radius * GetInnerRadius(), GetCircleColor(), GetAlternateCircleColor(), GetCircleSegments(), RefThetaRotation());
-            }
-            
-
-            // Apply push to central circle's position (in pixel space)
-            central_pixel_pos.x += total_push.x;
-            central_pixel_pos.y += total_push.y;
-
-            // Clamp to window bounds
-            central_pixel_pos.x = std::max(central_pixel_radius, std::min((float)width - central_pixel_radius, central_pixel_pos.x));
-            central_pixel_pos.y = std::max(central_pixel_radius, std::min((float)height - central_pixel_radius, central_pixel_pos.y));
-
-            // drift back to center
-            const ImVec2 center_normalized(0.5f, 0.5f);
-            const float push_magnitude = std::sqrt(total_push.x * total_push.x + total_push.y * total_push.y);
-            if (push_magnitude < 0.05f) {
-                // Drift in normalized space
-                RefCentralCircleCenter() = lerp(RefCentralCircleCenter(), center_normalized, GetDriftSpeed());
-                central_pixel_pos.x = RefCentralCircleCenter().x * width;
-                central_pixel_pos.y = RefCentralCircleCenter().y * height;
-            }
-
-            // Convert back to normalized coordinates
-            RefCentralCircleCenter().x = central_pixel_pos.x / width;
-            RefCentralCircleCenter().y = central_pixel_pos.y / height;
-
-            if (!GetDynamicCircle()) {
-                draw_filled_circle(central_pixel_pos.x, central_pixel_pos.y, central_pixel_radius, GetCentralCircleColor(), GetAlternateCentralCircleColor(), GetCentralCircleSegments());
-            } else {
-                double elapsed = ImGui::GetTime() - RefDynamicCircleStartTime();
-                if (elapsed <= GetDynamicCircleLingerDuration() + GetDynamicCircleMaxDuration()) {
-                    RefDynamicCircleRadius() = std::min(
-                        GetDynamicCircleMaxRadius(),
-                        ((float) elapsed / GetDynamicCircleMaxDuration()) * GetDynamicCircleMaxRadius()
-                    );
-                    draw_filled_circle(central_pixel_pos.x, central_pixel_pos.y,
-                                    RefDynamicCircleRadius() * std::min(width, height),
-                                    GetCentralCircleColor(), GetCentralCircleSegments());
-                } else { 
-                    RefDynamicCircleRadius() = 0.0f;
-                }
-            }
-
-            // rotate circles if enabled
-            if (GetRotationRunning()) {
-                double now = ImGui::GetTime();
-                if (!RefInRotationPhase() && !RefInDelayPhase()) {
-                    RefStartTheta() = RefThetaRotation();
-                    if (GetRandomRotation()) {
-                        float magnitude = GetMinRotation() + static_cast<float>(rand()) / RAND_MAX * (GetMaxRotation() - GetMinRotation());
-                        int dir = GetRandomizeRotationDirection() ? (rand() % 2 == 0 ? 1 : -1) : GetRotationDirection();
-                        RefTargetTheta() = RefThetaRotation() + dir * magnitude;
-                    }
-                    if (GetRandomizeRotationTime()) {
-                        RefActualRotationTime() = GetMinRotationTime() + static_cast<float>(rand()) / RAND_MAX * (GetMaxRotationTime() - GetMinRotationTime());
-                    } else {
-                        RefActualRotationTime() = GetRotationTime();
-                    }
-                    if (GetRandomizeRotationDelay()) {
-                        RefActualRotationDelay() = GetMinRotationDelay() + static_cast<float>(rand()) / RAND_MAX * (GetMaxRotationDelay() - GetMinRotationDelay());
-                    } else {
-                        RefActualRotationDelay() = GetRotationDelay();
-                    }
-                    // rotation_start_time = now; (move to module if needed)
-                    RefInRotationPhase() = true;
-                }
-                if (RefInRotationPhase()) {
-                    float t = static_cast<float>((now - RefRotationStartTime()) / RefActualRotationTime());
-                    if (t >= 1.0f) {
-                        RefThetaRotation() = RefTargetTheta();
-                        RefInRotationPhase() = false;
-                        RefInDelayPhase() = true;
-                        // rotation_start_time = now; (move to module if needed)
-                    } else {
-                        RefThetaRotation() = RefStartTheta() + t * (RefTargetTheta() - RefStartTheta());
-                    }
-                } else if (RefInDelayPhase()) {
-                    if ((now - RefRotationStartTime()) >= RefActualRotationDelay()) {
-                        RefInDelayPhase() = false;
-                    }
-                }
-            }
-
-            // Draw central circle
-            
-
-            if (RefCalibrating()) {
-                draw_filled_circle(width / 2.0 - height / 2.0, 0, 20, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
-                draw_filled_circle(width / 2.0 + height / 2.0, 0, 20, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
-                draw_filled_circle(width / 2.0 - height / 2.0, height, 20, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
-                draw_filled_circle(width / 2.0 + height / 2.0, height, 20, ImVec4(1.0f, 1.0f, 1.0f, 1.0f));
-            }
-
-            uint64_t now = get_time_us();
-            // format latency in seconds
-            uint64_t latency = now - spotlight_timestamp;
-
-            std::string latency_str = "render latency: " + std::to_string(latency / 1000.0) + " ms";
-
-            if (latency > 100000) {
-                std::cout << "high latency: " << latency_str << std::endl;
-            }
-
-            glfwSwapBuffers(spotlight_window);
-        }
-
-        // Render control window AFTER spotlight window to minimize spotlight latency
-        glfwMakeContextCurrent(control_window);
         ImGui::Render();
         int display_w, display_h;
         glfwGetFramebufferSize(control_window, &display_w, &display_h);
@@ -421,12 +214,25 @@ int main() {
         glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
         glClear(GL_COLOR_BUFFER_BIT);
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        glfwSwapBuffers(control_window);
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(control_window);
+        }
+
+        // Sleep out the rest of the UI frame, waking early on input
+        double remaining = frame_start + 1.0 / kControlUiHz - glfwGetTime();
+        if (remaining > 0.0) {
+            glfwWaitEventsTimeout(remaining);
+        }
     }
 
     // Cleanup
-    running = false;
-    reader_thread.join();
+    StopSpotlightRenderer();
+    StopPumpScheduler();
+    StopBoxReader();
+    if (!trace_on_exit.empty()) {
+        DumpProfileTrace(trace_on_exit.c_str(), 10.0);
+    }
 
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -1,10 +1,11 @@
 #include "spotlight_controls.h"
+#include "profiler.h"
+#include "projection.h"
 #include "imgui.h"
 #include <algorithm>
 
 namespace {
 static bool use_second_monitor = true;
-static ImVec2 circle_center = ImVec2(0.5f, 0.5f);
 static float circle_radius = 0.1f;
 static ImVec4 circle_color = ImVec4(1.0f, 0.0f, 0.0f, 1.0f);
 static ImVec4 alternate_circle_color = ImVec4(0.0f, 0.0f, 0.0f, 1.0f);
@@ -25,33 +26,32 @@ static float rotation_delay = 0.0f;
 static float min_rotation_delay = 0.0f;
 static float max_rotation_delay = 5.0f;
 static bool rotation_running = false;
-static double rotation_start_time = -1.0;
-static float target_theta = 0.0f;
-static float start_theta = 0.0f;
-static float actual_rotation_time = 1.0f;
-static float actual_rotation_delay = 0.0f;
-static bool in_rotation_phase = false;
-static bool in_delay_phase = false;
-static ImVec2 central_circle_center = ImVec2(0.5f, 0.5f);
 static float central_circle_radius = 0.1f;
 static ImVec4 central_circle_color = ImVec4(1.0f, 1.0f, 0.0f, 1.0f);
 static ImVec4 alternate_central_circle_color = ImVec4(1.0f, 1.0f, 0.0f, 1.0f);
 static int central_circle_segments = 64;
 static float drift_speed = 0.1f;
-static float dynamic_circle_radius = 0.0f;
 static float dynamic_circle_max_duration = 3.0f;
 static float dynamic_circle_max_radius = 0.2f;
 static float dynamic_circle_linger_duration = 1.0f;
-static double dynamic_circle_start_time = -1.0;
 static bool collision_enabled = true;
 static bool calibrating = false;
 static bool dynamic_circle = false;
 static float calibration_offset_x = 545.0f;
 static float calibration_offset_y = 379.0f;
 static float calibration_scale = 1254.0f;
+static int shape_render_mode = SHAPE_RENDER_INSTANCED;
+static const char* shape_render_modes[] = { "Immediate", "Instanced Mesh", "SDF Shader" };
+
+static uint32_t rotation_start_count = 0;
+static uint32_t theta_set_count = 0;
+static uint32_t central_reset_count = 0;
+static uint32_t dynamic_circle_reset_count = 0;
+static uint32_t dynamic_circle_trigger_count = 0;
 }
 
 void RenderSpotlightControls(bool has_second_monitor) {
+    PROFILE_ZONE("RenderSpotlightControls");
     ImGui::Begin("Spotlight Controls");
     if (!has_second_monitor) {
         ImGui::TextColored(ImVec4(1, 0, 0, 1), "No second monitor detected!");
@@ -80,22 +80,23 @@ void RenderSpotlightControls(bool has_second_monitor) {
                 ImGui::SliderFloat("Rotation Delay", &rotation_delay, 0.0f, 10.0f);
             }
         } else {
-            ImGui::SliderFloat("Theta Rotation", &theta_rotation, 0.0f, 6.28319f);
+            if (ImGui::SliderFloat("Theta Rotation", &theta_rotation, 0.0f, 6.28319f)) {
+                theta_set_count++;
+            }
         }
         if (rotation_running) {
             if (ImGui::Button("Stop Rotation")) {
                 rotation_running = false;
-                in_rotation_phase = false;
-                in_delay_phase = false;
             }
         } else {
             if (ImGui::Button("Start Rotation")) {
                 rotation_running = true;
-                rotation_start_time = ImGui::GetTime();
+                rotation_start_count++;
             }
         }
         ImGui::ColorEdit4("Alternate Circle Color", (float*)&alternate_circle_color);
         ImGui::SliderInt("Circle Segments", &circle_segments, 3, 128);
+        ImGui::Combo("Shape Rendering", &shape_render_mode, shape_render_modes, IM_ARRAYSIZE(shape_render_modes));
     }
     ImGui::Spacing();
     ImGui::Separator();
@@ -104,7 +105,7 @@ void RenderSpotlightControls(bool has_second_monitor) {
     ImGui::ColorEdit4("Central Circle Color", (float*)&central_circle_color);
     ImGui::SliderInt("Central Circle Segments", &central_circle_segments, 3, 128);
     if (ImGui::Button("Reset Central Position")) {
-        central_circle_center = ImVec2(0.5f, 0.5f);
+        central_reset_count++;
     }
     ImGui::SliderFloat("Drift Speed", &drift_speed, 0.005f, 0.2f);
     ImGui::Spacing();
@@ -115,8 +116,7 @@ void RenderSpotlightControls(bool has_second_monitor) {
     ImGui::SliderFloat("Dynamic Circle Linger Duration", &dynamic_circle_linger_duration, 1.0f, 60.0f, "%.1f s");
     if (ImGui::Checkbox("Dynamic Circle", &dynamic_circle)) {
         if (dynamic_circle) {
-            dynamic_circle_start_time = -999;
-            dynamic_circle_radius = 0.00f;
+            dynamic_circle_reset_count++;
         }
     }
     ImGui::Spacing();
@@ -130,52 +130,60 @@ void RenderSpotlightControls(bool has_second_monitor) {
     ImGui::SliderFloat("Calibration Offset X", &calibration_offset_x, -1920.0f, 1920.0f);
     ImGui::SliderFloat("Calibration Offset Y", &calibration_offset_y, -1080.0f, 1080.0f);
     ImGui::SliderFloat("Calibration Scale", &calibration_scale, 500.0f, 2000.0f);
+    ImGui::Text("Projection kernel: %s", kProjectionKernelNames[GetProjectionKernel()]);
+    ImGui::Spacing();
+    RenderHomographyControls(calibrating);
     ImGui::End();
 }
 
 // Interface implementations
-float GetCircleRadius() { return circle_radius; }
-float GetInnerRadius() { return inner_radius; }
-ImVec4 GetCircleColor() { return circle_color; }
-ImVec4 GetAlternateCircleColor() { return alternate_circle_color; }
-int GetCircleSegments() { return circle_segments; }
-ImVec2& RefCentralCircleCenter() { return central_circle_center; }
-float GetCentralCircleRadius() { return central_circle_radius; }
-ImVec4 GetCentralCircleColor() { return central_circle_color; }
-ImVec4 GetAlternateCentralCircleColor() { return alternate_central_circle_color; }
-int GetCentralCircleSegments() { return central_circle_segments; }
-float GetDriftSpeed() { return drift_speed; }
-bool GetCollisionEnabled() { return collision_enabled; }
-bool GetDynamicCircle() { return dynamic_circle; }
-double& RefDynamicCircleStartTime() { return dynamic_circle_start_time; }
-float& RefDynamicCircleRadius() { return dynamic_circle_radius; }
-bool& RefCalibrating() { return calibrating; }
+SpotlightParams GetSpotlightParams() {
+    SpotlightParams p;
+    p.use_second_monitor = use_second_monitor;
+    p.shape_render_mode = (ShapeRenderMode)shape_render_mode;
+    p.circle_radius = circle_radius;
+    p.inner_radius = inner_radius;
+    p.circle_color = circle_color;
+    p.alternate_circle_color = alternate_circle_color;
+    p.circle_segments = circle_segments;
+    p.rotation_running = rotation_running;
+    p.random_rotation = random_rotation;
+    p.min_rotation = min_rotation;
+    p.max_rotation = max_rotation;
+    p.randomize_rotation_direction = randomize_rotation_direction;
+    p.rotation_direction = rotation_direction;
+    p.randomize_rotation_time = randomize_rotation_time;
+    p.min_rotation_time = min_rotation_time;
+    p.max_rotation_time = max_rotation_time;
+    p.rotation_time = rotation_time;
+    p.randomize_rotation_delay = randomize_rotation_delay;
+    p.min_rotation_delay = min_rotation_delay;
+    p.max_rotation_delay = max_rotation_delay;
+    p.rotation_delay = rotation_delay;
+    p.theta_rotation = theta_rotation;
+    p.central_circle_radius = central_circle_radius;
+    p.central_circle_color = central_circle_color;
+    p.alternate_central_circle_color = alternate_central_circle_color;
+    p.central_circle_segments = central_circle_segments;
+    p.drift_speed = drift_speed;
+    p.collision_enabled = collision_enabled;
+    p.dynamic_circle = dynamic_circle;
+    p.dynamic_circle_max_duration = dynamic_circle_max_duration;
+    p.dynamic_circle_max_radius = dynamic_circle_max_radius;
+    p.dynamic_circle_linger_duration = dynamic_circle_linger_duration;
+    p.calibrating = calibrating;
+    p.calibration_dot = GetCalibrationDot();
+    p.calibration_offset_x = calibration_offset_x;
+    p.calibration_offset_y = calibration_offset_y;
+    p.calibration_scale = calibration_scale;
+    p.homography = GetHomographyCalibration();
+    p.rotation_start_count = rotation_start_count;
+    p.theta_set_count = theta_set_count;
+    p.central_reset_count = central_reset_count;
+    p.dynamic_circle_reset_count = dynamic_circle_reset_count;
+    p.dynamic_circle_trigger_count = dynamic_circle_trigger_count;
+    return p;
+}
+
 bool GetUseSecondMonitor() { return use_second_monitor; }
-float GetDynamicCircleMaxDuration() { return dynamic_circle_max_duration; }
-float GetDynamicCircleMaxRadius() { return dynamic_circle_max_radius; }
-float GetDynamicCircleLingerDuration() { return dynamic_circle_linger_duration; }
-bool GetRotationRunning() { return rotation_running; }
-bool& RefInRotationPhase() { return in_rotation_phase; }
-bool& RefInDelayPhase() { return in_delay_phase; }
-float& RefStartTheta() { return start_theta; }
-float& RefThetaRotation() { return theta_rotation; }
-bool GetRandomRotation() { return random_rotation; }
-float GetMinRotation() { return min_rotation; }
-float GetMaxRotation() { return max_rotation; }
-bool GetRandomizeRotationDirection() { return randomize_rotation_direction; }
-int GetRotationDirection() { return rotation_direction; }
-float& RefTargetTheta() { return target_theta; }
-bool GetRandomizeRotationTime() { return randomize_rotation_time; }
-float GetMinRotationTime() { return min_rotation_time; }
-float GetMaxRotationTime() { return max_rotation_time; }
-float& RefActualRotationTime() { return actual_rotation_time; }
-float GetRotationTime() { return rotation_time; }
-bool GetRandomizeRotationDelay() { return randomize_rotation_delay; }
-float GetMinRotationDelay() { return min_rotation_delay; }
-float GetMaxRotationDelay() { return max_rotation_delay; }
-float& RefActualRotationDelay() { return actual_rotation_delay; }
-float GetRotationDelay() { return rotation_delay; }
-double& RefRotationStartTime() { return rotation_start_time; }
-float GetCalibrationOffsetX() { return calibration_offset_x; }
-float GetCalibrationOffsetY() { return calibration_offset_y; }
-float GetCalibrationScale() { return calibration_scale; }
+void TriggerDynamicCircle() { dynamic_circle_trigger_count++; }
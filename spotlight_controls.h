@@ -1,54 +1,63 @@
 #pragma once
 #include "imgui.h"
+#include "shape_renderer.h"
+#include "calibration.h"
+#include <cstdint>
 
-void RenderSpotlightControls(bool has_second_monitor);
+// Spotlight settings as edited in the control panel. One-shot UI actions are
+// counters; the renderer acts when a counter changes.
+struct SpotlightParams {
+    bool use_second_monitor;
+    ShapeRenderMode shape_render_mode;
+
+    // tracked-object rings
+    float circle_radius;
+    float inner_radius;
+    ImVec4 circle_color;
+    ImVec4 alternate_circle_color;
+    int circle_segments;
+
+    // ring rotation
+    bool rotation_running;
+    bool random_rotation;
+    float min_rotation, max_rotation;
+    bool randomize_rotation_direction;
+    int rotation_direction;
+    bool randomize_rotation_time;
+    float min_rotation_time, max_rotation_time, rotation_time;
+    bool randomize_rotation_delay;
+    float min_rotation_delay, max_rotation_delay, rotation_delay;
+    float theta_rotation;  // manual angle, applied when theta_set_count changes
+
+    // central circle
+    float central_circle_radius;
+    ImVec4 central_circle_color;
+    ImVec4 alternate_central_circle_color;
+    int central_circle_segments;
+    float drift_speed;
+    bool collision_enabled;
+    bool dynamic_circle;
+    float dynamic_circle_max_duration;
+    float dynamic_circle_max_radius;
+    float dynamic_circle_linger_duration;
 
-// Spotlight state interface for main loop
-float GetCircleRadius();
-float GetInnerRadius();
-ImVec4 GetCircleColor();
-ImVec4 GetAlternateCircleColor();
-int GetCircleSegments();
-ImVec2& RefCentralCircleCenter();
-float GetCentralCircleRadius();
-ImVec4 GetCentralCircleColor();
-ImVec4 GetAlternateCentralCircleColor();
-int GetCentralCircleSegments();
-float GetDriftSpeed();
-bool GetCollisionEnabled();
-bool GetDynamicCircle();
-double& RefDynamicCircleStartTime();
-float& RefDynamicCircleRadius();
-bool& RefCalibrating();
+    bool calibrating;
+    int calibration_dot;  // highlighted while capturing homography points
+    float calibration_offset_x;
+    float calibration_offset_y;
+    float calibration_scale;
+    HomographyCalibration homography;  // replaces offset/scale when enabled
+
+    uint32_t rotation_start_count;
+    uint32_t theta_set_count;
+    uint32_t central_reset_count;
+    uint32_t dynamic_circle_reset_count;    // dynamic circle switched on
+    uint32_t dynamic_circle_trigger_count;  // a pump dispensed
+};
+
+void RenderSpotlightControls(bool has_second_monitor);
+SpotlightParams GetSpotlightParams();
 bool GetUseSecondMonitor();
-float GetDynamicCircleMaxDuration();
-float GetDynamicCircleMaxRadius();
-float GetDynamicCircleLingerDuration();
-bool GetRotationRunning();
-bool& RefInRotationPhase();
-bool& RefInDelayPhase();
-float& RefStartTheta();
-float& RefThetaRotation();
-bool GetRandomRotation();
-float GetMinRotation();
-float GetMaxRotation();
-bool GetRandomizeRotationDirection();
-int GetRotationDirection();
-float& RefTargetTheta();
-bool GetRandomizeRotationTime();
-float GetMinRotationTime();
-float GetMaxRotationTime();
-float& RefActualRotationTime();
-float GetRotationTime();
-bool GetRandomizeRotationDelay();
-float GetMinRotationDelay();
-float GetMaxRotationDelay();
-float& RefActualRotationDelay();
-float GetRotationDelay();
-double& RefRotationStartTime();
-
-// Calibration offset controls
-float GetCalibrationOffsetX();
-float GetCalibrationOffsetY();
-float GetCalibrationScale();
-// ...add more as needed for main loop rendering...
+
+// Restart the dynamic circle's growth, e.g. when a pump dispenses
+void TriggerDynamicCircle();
@@ -0,0 +1,441 @@
+#include "spotlight_renderer.h"
+#include "shaman/shaman.h"
+#include "serial/serial.h"
+#include "pump_controls.h"
+#include "box_reader.h"
+#include "latency_stats.h"
+#include "motion_predictor.h"
+#include "frame_pacing.h"
+#include "gpu_timer.h"
+#include "profiler.h"
+#include "alloc_counter.h"
+#include "frame_arena.h"
+#include "projection.h"
+#include "warp_pass.h"
+#include "ring_renderer.h"
+#include "triple_buffer.h"
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+namespace {
+static TripleBuffer<StimulusParams> stimulus_params;
+static std::thread render_thread;
+static std::atomic<bool> running{false};
+static std::atomic<int> framebuffer_width{0};
+static std::atomic<int> framebuffer_height{0};
+
+// Per-frame scratch arrays, reset at the start of every frame
+static FrameArena frame_arena;
+
+// Stimulus state the renderer advances from frame to frame
+struct SpotlightState {
+    ImVec2 central_circle_center = ImVec2(0.5f, 0.5f);
+    double dynamic_circle_start_time = -1.0;
+    float dynamic_circle_radius = 0.0f;
+    float theta_rotation = 0.0f;
+    float start_theta = 0.0f;
+    float target_theta = 0.0f;
+    float actual_rotation_time = 1.0f;
+    float actual_rotation_delay = 0.0f;
+    double rotation_start_time = -1.0;
+    bool in_rotation_phase = false;
+    bool in_delay_phase = false;
+    int prev_count = -1;
+
+    // last UI event counters acted on
+    uint32_t rotation_start_count = 0;
+    uint32_t theta_set_count = 0;
+    uint32_t central_reset_count = 0;
+    uint32_t dynamic_circle_reset_count = 0;
+    uint32_t dynamic_circle_trigger_count = 0;
+};
+static SpotlightState state;
+
+// Tracked objects in spotlight window pixels, one array per coordinate
+struct ProjectedObjects {
+    const float* x;
+    const float* y;
+    int count;
+};
+
+// The single camera-to-projector stage; rings, collision and the salesman
+// experiment all read its output
+static ProjectedObjects project_objects(const ImVec2* centers, int count, const SpotlightParams& sp, int width, int height) {
+    PROFILE_ZONE("project_objects");
+    float* x = frame_arena.alloc<float>(count);
+    float* y = frame_arena.alloc<float>(count);
+    CalibrationTransform t = sp.homography.enabled
+        ? HomographyTransform(sp.homography, width, height)
+        : MakeCalibrationTransform(sp.calibration_offset_x, sp.calibration_offset_y, sp.calibration_scale, width, height);
+    ProjectPoints(reinterpret_cast<const float*>(centers), count, t, x, y);
+    ProjectedObjects objects = { x, y, count };
+    return objects;
+}
+
+ImVec2 lerp(const ImVec2& a, const ImVec2& b, float t) {
+    return ImVec2(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+}
+
+static void draw_filled_circle(ShapeRenderMode mode, float cx, float cy, float r, ImVec4 color, int segments = 64) {
+    if (mode == SHAPE_RENDER_SDF && ShapeShaderAvailable()) {
+        ShapeInstance disc = { cx, cy, r, 0.0f, 0.0f, (float)segments, (float)segments, color, color };
+        DrawShapes(&disc, 1);
+        return;
+    }
+    glColor4f(color.x, color.y, color.z, color.w);
+    glBegin(GL_TRIANGLE_FAN);
+    glVertex2f(cx, cy); // center
+    for (int i = 0; i <= segments; ++i) {
+        float theta = (2.0f * 3.1415926f * float(i)) / float(segments);
+        float x = r * cosf(theta);
+        float y = r * sinf(theta);
+        glVertex2f(cx + x, cy + y);
+    }
+    glEnd();
+}
+
+static void draw_filled_circle(ShapeRenderMode mode, float cx, float cy, float r, ImVec4 color1, ImVec4 color2, int segments = 64) {
+    // draw filled circle with alternating colors
+    if (mode == SHAPE_RENDER_SDF && ShapeShaderAvailable()) {
+        ShapeInstance disc = { cx, cy, r, 0.0f, 0.0f, (float)segments, 32.0f, color1, color2 };
+        DrawShapes(&disc, 1);
+        return;
+    }
+    glBegin(GL_TRIANGLE_FAN);
+    glVertex2f(cx, cy);
+    for (int i = 0; i <= segments; ++i) {
+        float theta = (2.0f * 3.1415926f * float(i)) / float(segments);
+        float x = r * cosf(theta);
+        float y = r * sinf(theta);
+        
+        if (i % 64 < 32) {
+            glColor4f(color1.x, color1.y, color1.z, color1.w);
+        } else {
+            glColor4f(color2.x, color2.y, color2.z, color2.w);
+        }
+        glVertex2f(cx + x, cy + y);
+    }
+    glEnd();
+}
+
+// Act on one-shot UI events, each published as a counter
+static void apply_events(const SpotlightParams& p, double time) {
+    if (p.rotation_start_count != state.rotation_start_count) {
+        state.rotation_start_count = p.rotation_start_count;
+        state.rotation_start_time = time;
+    }
+    if (!p.rotation_running) {
+        state.in_rotation_phase = false;
+        state.in_delay_phase = false;
+    }
+    if (p.theta_set_count != state.theta_set_count) {
+        state.theta_set_count = p.theta_set_count;
+        state.theta_rotation = p.theta_rotation;
+    }
+    if (p.central_reset_count != state.central_reset_count) {
+        state.central_reset_count = p.central_reset_count;
+        state.central_circle_center = ImVec2(0.5f, 0.5f);
+    }
+    if (p.dynamic_circle_reset_count != state.dynamic_circle_reset_count) {
+        state.dynamic_circle_reset_count = p.dynamic_circle_reset_count;
+        state.dynamic_circle_start_time = -999;
+        state.dynamic_circle_radius = 0.00f;
+    }
+    if (p.dynamic_circle_trigger_count != state.dynamic_circle_trigger_count) {
+        state.dynamic_circle_trigger_count = p.dynamic_circle_trigger_count;
+        state.dynamic_circle_start_time = time;
+        state.dynamic_circle_radius = 0.00f;
+    }
+}
+
+// Draws one stimulus frame and advances the renderer-owned stimulus state
+static void draw_stimulus(const StimulusParams& params, int width, int height, double time, const BoxFrame& current_frame_boxes, uint64_t consumed_timestamp) {
+    PROFILE_ZONE("draw_stimulus");
+    const SpotlightParams& sp = params.spotlight;
+    apply_events(sp, time);
+
+    // Draw gratings FIRST so they appear beneath everything else
+    BeginGpuLayer(GPU_LAYER_GRATINGS);
+    DrawMovingGratings(params.gratings, width, height, time);
+    EndGpuLayer();
+    BeginGpuLayer(GPU_LAYER_CONCENTRIC_RINGS);
+    DrawConcentricRings(params.rings, width, height, time);
+    EndGpuLayer();
+    BeginGpuLayer(GPU_LAYER_SALESMAN);
+    DrawSalesmanExperiment(params.salesman, sp.shape_render_mode, width, height, time);
+    EndGpuLayer();
+
+    // Camera-space box centers, extrapolated to the next swap if prediction is on
+    const ImVec2* box_centers = PredictBoxCenters(current_frame_boxes, GetPredictedPresentTime(consumed_timestamp));
+    const ProjectedObjects objects = project_objects(box_centers, current_frame_boxes.count, sp, width, height);
+    const float circle_radius = sp.circle_radius * height;
+
+    // --- Salesman Experiment update logic ---
+    if (UpdateSalesmanExperiment(params.salesman, width, height, time, objects.x, objects.y, objects.count,
+                                 circle_radius, get_serial(), get_pump_ids())) {
+        // Use the exact same logic as a pump dispense for the dynamic circle
+        if (sp.dynamic_circle) {
+            state.dynamic_circle_start_time = time;
+            state.dynamic_circle_radius = 0.00f;
+        }
+    }
+
+    // Actual central circle position in pixels
+    ImVec2 central_pixel_pos = ImVec2(
+        state.central_circle_center.x * width,
+        state.central_circle_center.y * height
+    );
+    float central_pixel_radius = sp.central_circle_radius * std::min(width, height);
+
+    // Accumulated push vector
+    ImVec2 total_push = ImVec2(0, 0);
+    
+    const DoorParams& doors = params.doors;
+    if (!doors.manual_override && current_frame_boxes.size() != state.prev_count && current_frame_boxes.size() >= doors.object_limit && IsDoorSerialOpen()) {
+        std::cout << "Sending door command to close all doors" << std::endl;
+        SendDoorCommand("c1c2c3");
+    } else if (!doors.manual_override && current_frame_boxes.size() != state.prev_count && current_frame_boxes.size() < doors.object_limit && IsDoorSerialOpen()) {
+        std::cout << "Sending door command to open all doors" << std::endl;
+        SendDoorCommand("o1o2o3");
+    }
+    state.prev_count = current_frame_boxes.size();
+    
+    RingInstance* rings = frame_arena.alloc<RingInstance>(objects.count);
+    for (int i = 0; i < objects.count; ++i) {
+        float cx = objects.x[i];
+        float cy = objects.y[i];
+        float radius = circle_radius;
+        if (sp.collision_enabled) {
+            // Calculate vector between centers
+            float dx = central_pixel_pos.x - cx;
+            float dy = central_pixel_pos.y - cy;
+            float dist_sq = dx * dx + dy * dy;
+            float min_dist = central_pixel_radius + radius;
+
+            if (dist_sq < min_dist * min_dist && dist_sq > 0.0f) {
+                float dist = std::sqrt(dist_sq);
+                float push_strength = (min_dist - dist) * 0.5f; // Push half the overlap
+                total_push.x += (dx / dist) * push_strength;
+                total_push.y += (dy / dist) * push_strength;
+            }
+
+        }
+        
+        rings[i] = {cx, cy, radius, sp.inner_radius, 0.0f};
+    }
+    BeginGpuLayer(GPU_LAYER_TRACKED_RINGS);
+    DrawRings(rings, objects.count, sp.circle_color, sp.alternate_circle_color,
+              sp.circle_segments, state.theta_rotation, sp.shape_render_mode);
+    EndGpuLayer();
+    
+
+    // Apply push to central circle's position (in pixel space)
+    central_pixel_pos.x += total_push.x;
+    central_pixel_pos.y += total_push.y;
+
+    // Clamp to window bounds
+    central_pixel_pos.x = std::max(central_pixel_radius, std::min((float)width - central_pixel_radius, central_pixel_pos.x));
+    central_pixel_pos.y = std::max(central_pixel_radius, std::min((float)height - central_pixel_radius, central_pixel_pos.y));
+
+    // drift back to center
+    const ImVec2 center_normalized(0.5f, 0.5f);
+    const float push_magnitude = std::sqrt(total_push.x * total_push.x + total_push.y * total_push.y);
+    if (push_magnitude < 0.05f) {
+        // Drift in normalized space
+        state.central_circle_center = lerp(state.central_circle_center, center_normalized, sp.drift_speed);
+        central_pixel_pos.x = state.central_circle_center.x * width;
+        central_pixel_pos.y = state.central_circle_center.y * height;
+    }
+
+    // Convert back to normalized coordinates
+    state.central_circle_center.x = central_pixel_pos.x / width;
+    state.central_circle_center.y = central_pixel_pos.y / height;
+
+    BeginGpuLayer(GPU_LAYER_CENTRAL_CIRCLE);
+    if (!sp.dynamic_circle) {
+        draw_filled_circle(sp.shape_render_mode, central_pixel_pos.x, central_pixel_pos.y, central_pixel_radius, sp.central_circle_color, sp.alternate_central_circle_color, sp.central_circle_segments);
+    } else {
+        double elapsed = time - state.dynamic_circle_start_time;
+        if (elapsed <= sp.dynamic_circle_linger_duration + sp.dynamic_circle_max_duration) {
+            state.dynamic_circle_radius = std::min(
+                sp.dynamic_circle_max_radius,
+                ((float) elapsed / sp.dynamic_circle_max_duration) * sp.dynamic_circle_max_radius
+            );
+            draw_filled_circle(sp.shape_render_mode, central_pixel_pos.x, central_pixel_pos.y,
+                            state.dynamic_circle_radius * std::min(width, height),
+                            sp.central_circle_color, sp.central_circle_segments);
+        } else { 
+            state.dynamic_circle_radius = 0.0f;
+        }
+    }
+    EndGpuLayer();
+
+    // rotate circles if enabled
+    if (sp.rotation_running) {
+        double now = time;
+        if (!state.in_rotation_phase && !state.in_delay_phase) {
+            state.start_theta = state.theta_rotation;
+            if (sp.random_rotation) {
+                float magnitude = sp.min_rotation + static_cast<float>(rand()) / RAND_MAX * (sp.max_rotation - sp.min_rotation);
+                int dir = sp.randomize_rotation_direction ? (rand() % 2 == 0 ? 1 : -1) : sp.rotation_direction;
+                state.target_theta = state.theta_rotation + dir * magnitude;
+            }
+            if (sp.randomize_rotation_time) {
+                state.actual_rotation_time = sp.min_rotation_time + static_cast<float>(rand()) / RAND_MAX * (sp.max_rotation_time - sp.min_rotation_time);
+            } else {
+                state.actual_rotation_time = sp.rotation_time;
+            }
+            if (sp.randomize_rotation_delay) {
+                state.actual_rotation_delay = sp.min_rotation_delay + static_cast<float>(rand()) / RAND_MAX * (sp.max_rotation_delay - sp.min_rotation_delay);
+            } else {
+                state.actual_rotation_delay = sp.rotation_delay;
+            }
+            // rotation_start_time = now; (move to module if needed)
+            state.in_rotation_phase = true;
+        }
+        if (state.in_rotation_phase) {
+            float t = static_cast<float>((now - state.rotation_start_time) / state.actual_rotation_time);
+            if (t >= 1.0f) {
+                state.theta_rotation = state.target_theta;
+                state.in_rotation_phase = false;
+                state.in_delay_phase = true;
+                // rotation_start_time = now; (move to module if needed)
+            } else {
+                state.theta_rotation = state.start_theta + t * (state.target_theta - state.start_theta);
+            }
+        } else if (state.in_delay_phase) {
+            if ((now - state.rotation_start_time) >= state.actual_rotation_delay) {
+                state.in_delay_phase = false;
+            }
+        }
+    }
+
+    if (sp.calibrating) {
+        BeginGpuLayer(GPU_LAYER_CALIBRATION);
+        const ImVec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+        const ImVec4 green(0.0f, 1.0f, 0.0f, 1.0f);
+        for (int dot = 0; dot < kCalibrationDots; ++dot) {
+            float x, y;
+            CalibrationDotPosition(dot, width, height, x, y);
+            draw_filled_circle(sp.shape_render_mode, x, y, 20, dot == sp.calibration_dot ? green : white);
+        }
+        EndGpuLayer();
+        PublishCalibrationProbe(current_frame_boxes, width, height);
+    }
+}
+
+static void render_loop(GLFWwindow* window) {
+    glfwMakeContextCurrent(window);
+    SetProfilerThreadName("render");
+
+    while (running && !glfwWindowShouldClose(window)) {
+        // May sleep until just before the next vblank, so sample everything after it
+        FramePacingMode pacing = BeginPacedFrame();
+        uint64_t allocations_before = ThreadAllocationCount();
+        frame_arena.reset();
+
+        stimulus_params.update();
+        const StimulusParams& params = stimulus_params.read_slot();
+        if (!params.spotlight.use_second_monitor) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        // Take the latest boxes IMMEDIATELY for minimum latency
+        const BoxFrame& current_frame_boxes = AcquireLatestBoxes();
+        uint64_t consumed_timestamp = get_time_us();
+
+        int width = framebuffer_width;
+        int height = framebuffer_height;
+        BeginGpuFrame();
+        // With the warp pass on, the stimulus is drawn offscreen and warped onto the window
+        bool warping = BeginWarpPass(width, height);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Set up OpenGL state once
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrtho(0, width, height, 0, -1, 1);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glDisable(GL_DEPTH_TEST);  // Disable depth testing for 2D
+        glEnable(GL_BLEND);        // Enable blending for transparency
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        draw_stimulus(params, width, height, glfwGetTime(), current_frame_boxes, consumed_timestamp);
+        if (warping) {
+            BeginGpuLayer(GPU_LAYER_WARP);
+            EndWarpPass(width, height);
+            EndGpuLayer();
+        }
+
+        uint64_t now = get_time_us();
+        // format latency in seconds
+        uint64_t latency = now - consumed_timestamp;
+
+        if (latency > 100000) {
+            char latency_str[64];
+            std::snprintf(latency_str, sizeof(latency_str), "render latency: %f ms", latency / 1000.0);
+            std::cout << "high latency: " << latency_str << std::endl;
+            RequestProfileCapture();
+        }
+
+        FrameTiming timing;
+        timing.sequence = current_frame_boxes.sequence;
+        timing.writer_us = current_frame_boxes.writer_timestamp;
+        timing.received_us = current_frame_boxes.received_us;
+        timing.consumed_us = consumed_timestamp;
+        timing.submitted_us = now;
+        timing.objects = current_frame_boxes.count;
+        timing.pacing = pacing;
+
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+            if (pacing != PACING_UNCAPPED) {
+                // Block until the flip so the swap time marks the vblank
+                glFinish();
+            }
+        }
+
+        timing.swapped_us = get_time_us();
+        EndPacedFrame(now, timing.swapped_us);
+        RecordFrameTiming(timing);
+        ObservePresentDelay(timing.swapped_us - consumed_timestamp);
+        RecordFrameAllocations(ThreadAllocationCount() - allocations_before);
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+}
+
+void StartSpotlightRenderer(GLFWwindow* spotlight_window) {
+    if (running) return;
+    running = true;
+    render_thread = std::thread(render_loop, spotlight_window);
+}
+
+void StopSpotlightRenderer() {
+    running = false;
+    if (render_thread.joinable()) {
+        render_thread.join();
+    }
+}
+
+void SetSpotlightFramebufferSize(int width, int height) {
+    framebuffer_width = width;
+    framebuffer_height = height;
+}
+
+void PublishStimulusParams(const StimulusParams& params) {
+    stimulus_params.write_slot() = params;
+    stimulus_params.publish();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include "stimulus_params.h"
+
+struct GLFWwindow;
+
+// Render the stimulus into spotlight_window on a dedicated thread, taking
+// the window's GL context. The control UI runs independently on the main
+// thread.
+void StartSpotlightRenderer(GLFWwindow* spotlight_window);
+void StopSpotlightRenderer();
+
+// GLFW window queries are main-thread only, so main keeps this current
+void SetSpotlightFramebufferSize(int width, int height);
+
+// Hand the renderer a new parameter snapshot. Single producer (the UI
+// thread); the renderer picks up the newest one at the start of each frame
+// without locking.
+void PublishStimulusParams(const StimulusParams& params);
@@ -0,0 +1,11 @@
+#include "stimulus_params.h"
+
+StimulusParams CollectStimulusParams() {
+    StimulusParams params;
+    params.spotlight = GetSpotlightParams();
+    params.gratings = GetGratingParams();
+    params.rings = GetConcentricRingsParams();
+    params.salesman = GetSalesmanParams();
+    params.doors = GetDoorParams();
+    return params;
+}
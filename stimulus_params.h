@@ -0,0 +1,19 @@
+#pragma once
+#include "spotlight_controls.h"
+#include "grating_controls.h"
+#include "concentric_circles_controls.h"
+#include "salesman_experiment.h"
+#include "door_controls.h"
+
+// Everything the spotlight renderer reads from the control panels, copied
+// once per UI frame. The renderer never sees the panels' own variables.
+struct StimulusParams {
+    SpotlightParams spotlight;
+    GratingParams gratings;
+    ConcentricRingsParams rings;
+    SalesmanParams salesman;
+    DoorParams doors;
+};
+
+// Copy the current panel settings into a snapshot. UI thread only.
+StimulusParams CollectStimulusParams();
@@ -0,0 +1,205 @@
+// Synthetic tracker: writes simulated objects into the shaman shared-memory
+// queue that spotlight reads, stepping through a list of object counts.
+//
+//   synthetic_writer [--objects 1,10,100,1000,10000] [--rate 100]
+//                    [--duration 10] [--motion random|orbit] [--seed 1]
+//                    [--width 2048] [--height 2048]
+//
+// Prints a throughput and push-time report per object count. Pair it with
+// the Latency panel's scaling report in spotlight for the render side.
+#include "shaman/shaman.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <time.h>
+
+namespace {
+struct Options {
+    std::vector<int> object_counts = {1, 10, 100, 1000, 10000};
+    double rate_hz = 100.0;
+    double duration_s = 10.0;
+    bool orbit = false;
+    unsigned seed = 1;
+    float width = 2048.0f;
+    float height = 2048.0f;
+};
+
+struct StepReport {
+    int objects;
+    int frames;
+    int late_frames;
+    double achieved_hz;
+    double push_p50_us, push_p99_us, push_max_us;
+};
+
+struct SimObject {
+    float x, y;
+    float vx, vy;
+    float cx, cy, orbit_r, phase, omega;
+};
+
+uint64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void sleep_until_ns(uint64_t deadline_ns) {
+    timespec ts;
+    ts.tv_sec = deadline_ns / 1000000000ull;
+    ts.tv_nsec = deadline_ns % 1000000000ull;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+}
+
+std::vector<int> parse_counts(const char* s) {
+    std::vector<int> counts;
+    while (*s) {
+        counts.push_back(std::atoi(s));
+        const char* comma = std::strchr(s, ',');
+        if (!comma) break;
+        s = comma + 1;
+    }
+    return counts;
+}
+
+bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--objects" && has_value) opt.object_counts = parse_counts(argv[++i]);
+        else if (arg == "--rate" && has_value) opt.rate_hz = std::atof(argv[++i]);
+        else if (arg == "--duration" && has_value) opt.duration_s = std::atof(argv[++i]);
+        else if (arg == "--motion" && has_value) opt.orbit = std::string(argv[++i]) == "orbit";
+        else if (arg == "--seed" && has_value) opt.seed = (unsigned)std::atoi(argv[++i]);
+        else if (arg == "--width" && has_value) opt.width = (float)std::atof(argv[++i]);
+        else if (arg == "--height" && has_value) opt.height = (float)std::atof(argv[++i]);
+        else {
+            std::fprintf(stderr, "unknown argument: %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return opt.rate_hz > 0.0 && !opt.object_counts.empty();
+}
+
+void spawn(std::vector<SimObject>& sim, int count, const Options& opt, std::mt19937& rng) {
+    std::uniform_real_distribution<float> ux(0.0f, opt.width);
+    std::uniform_real_distribution<float> uy(0.0f, opt.height);
+    std::uniform_real_distribution<float> uv(-300.0f, 300.0f);
+    std::uniform_real_distribution<float> ur(20.0f, 400.0f);
+    std::uniform_real_distribution<float> uphase(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> uomega(-3.0f, 3.0f);
+    sim.resize(count);
+    for (SimObject& o : sim) {
+        o.x = ux(rng);
+        o.y = uy(rng);
+        o.vx = uv(rng);
+        o.vy = uv(rng);
+        o.cx = o.x;
+        o.cy = o.y;
+        o.orbit_r = ur(rng);
+        o.phase = uphase(rng);
+        o.omega = uomega(rng);
+    }
+}
+
+// Random walk with reflecting walls, or circular orbits around a fixed center
+void step(std::vector<SimObject>& sim, float t, float dt, const Options& opt, std::mt19937& rng) {
+    std::normal_distribution<float> accel(0.0f, 2000.0f);
+    for (SimObject& o : sim) {
+        if (opt.orbit) {
+            o.x = o.cx + o.orbit_r * std::cos(o.phase + o.omega * t);
+            o.y = o.cy + o.orbit_r * std::sin(o.phase + o.omega * t);
+            continue;
+        }
+        o.vx = std::max(-600.0f, std::min(600.0f, o.vx + accel(rng) * dt));
+        o.vy = std::max(-600.0f, std::min(600.0f, o.vy + accel(rng) * dt));
+        o.x += o.vx * dt;
+        o.y += o.vy * dt;
+        if (o.x < 0.0f || o.x > opt.width) { o.vx = -o.vx; o.x = std::max(0.0f, std::min(opt.width, o.x)); }
+        if (o.y < 0.0f || o.y > opt.height) { o.vy = -o.vy; o.y = std::max(0.0f, std::min(opt.height, o.y)); }
+    }
+}
+
+StepReport run_step(shaman::SharedBoxQueue& writer, int count, const Options& opt, std::mt19937& rng) {
+    std::vector<SimObject> sim;
+    spawn(sim, count, opt, rng);
+    std::vector<shaman::Object> boxes(count);
+    std::vector<double> push_us;
+    push_us.reserve((size_t)(opt.rate_hz * opt.duration_s) + 1);
+
+    const uint64_t period_ns = (uint64_t)(1e9 / opt.rate_hz);
+    const uint64_t start_ns = monotonic_ns();
+    const uint64_t end_ns = start_ns + (uint64_t)(opt.duration_s * 1e9);
+    uint64_t deadline = start_ns;
+    int late = 0;
+
+    while (deadline < end_ns) {
+        float t = (deadline - start_ns) / 1e9f;
+        step(sim, t, period_ns / 1e9f, opt, rng);
+        for (int i = 0; i < count; ++i) {
+            boxes[i] = shaman::Object();
+            boxes[i].rect.x = sim[i].x - 10.0f;
+            boxes[i].rect.y = sim[i].y + 10.0f;  // rect.y is the bottom edge
+            boxes[i].rect.width = 20.0f;
+            boxes[i].rect.height = 20.0f;
+        }
+
+        uint64_t before = monotonic_ns();
+        writer.push(boxes);
+        uint64_t after = monotonic_ns();
+        push_us.push_back((after - before) / 1000.0);
+
+        deadline += period_ns;
+        if (after > deadline) {
+            late++;
+            // drop the backlog instead of bursting to catch up
+            deadline = after - (after - start_ns) % period_ns + period_ns;
+        }
+        sleep_until_ns(deadline);
+    }
+
+    StepReport r;
+    r.objects = count;
+    r.frames = (int)push_us.size();
+    r.late_frames = late;
+    r.achieved_hz = r.frames / ((monotonic_ns() - start_ns) / 1e9);
+    std::sort(push_us.begin(), push_us.end());
+    r.push_p50_us = push_us.empty() ? 0.0 : push_us[(push_us.size() - 1) / 2];
+    r.push_p99_us = push_us.empty() ? 0.0 : push_us[(push_us.size() - 1) * 99 / 100];
+    r.push_max_us = push_us.empty() ? 0.0 : push_us.back();
+    return r;
+}
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        std::fprintf(stderr, "usage: synthetic_writer [--objects 1,10,100] [--rate hz] [--duration s] "
+                             "[--motion random|orbit] [--seed n] [--width px] [--height px]\n");
+        return 1;
+    }
+
+    shaman::SharedBoxQueue writer(true);
+    std::mt19937 rng(opt.seed);
+    std::vector<StepReport> reports;
+
+    for (int count : opt.object_counts) {
+        std::printf("writing %d objects at %.0f Hz for %.0f s...\n", count, opt.rate_hz, opt.duration_s);
+        std::fflush(stdout);
+        reports.push_back(run_step(writer, count, opt, rng));
+    }
+
+    std::printf("\n%8s %8s %8s %10s %10s %10s %10s\n",
+                "objects", "frames", "late", "rate_hz", "push_p50", "push_p99", "push_max");
+    for (const StepReport& r : reports) {
+        std::printf("%8d %8d %8d %10.1f %9.1fu %9.1fu %9.1fu\n",
+                    r.objects, r.frames, r.late_frames, r.achieved_hz,
+                    r.push_p50_us, r.push_p99_us, r.push_max_us);
+    }
+    return 0;
+}
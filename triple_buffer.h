@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+
+// Single-producer single-consumer "latest value" handoff. The writer fills
+// its private back slot and publishes it with one atomic exchange; the
+// reader swaps in the newest published slot. Neither side locks or
+// allocates, and a slot is never written while the reader holds it, so a
+// reader can not observe a torn value.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back_(0), middle_(1), front_(2) {}
+
+    // Writer side
+    T& write_slot() { return slots_[back_]; }
+    void publish() {
+        back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) & kIndexMask;
+    }
+
+    // Reader side. Returns true if a newer value was published since the
+    // last call; read_slot() stays valid until the next update().
+    bool update() {
+        if (!(middle_.load(std::memory_order_acquire) & kFresh)) return false;
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+        return true;
+    }
+    const T& read_slot() const { return slots_[front_]; }
+
+private:
+    static const int kIndexMask = 3;
+    static const int kFresh = 4;
+
+    T slots_[3];
+    alignas(64) int back_;
+    alignas(64) std::atomic<int> middle_;
+    alignas(64) int front_;
+};
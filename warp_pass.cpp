@@ -0,0 +1,270 @@
+#include "warp_pass.h"
+#include "profiler.h"
+#include "gl_shader.h"
+#include "imgui.h"
+#include "json.hpp"
+#include <GL/glew.h>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <vector>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+namespace {
+const char* kWarpDir = "/home/user/orange_data/config/warp";
+const int kMaxGridSize = 256;
+
+const char* kWarpVertexShader = R"(
+#version 130
+in vec4 a_vertex;  // target x, y and source u, v, as window fractions with y down
+out vec2 v_uv;
+void main() {
+    v_uv = vec2(a_vertex.z, 1.0 - a_vertex.w);
+    gl_Position = vec4(2.0 * a_vertex.x - 1.0, 1.0 - 2.0 * a_vertex.y, 0.0, 1.0);
+}
+)";
+
+const char* kWarpFragmentShader = R"(
+#version 130
+in vec2 v_uv;
+uniform sampler2D u_frame;
+void main() {
+    gl_FragColor = texture(u_frame, v_uv);
+}
+)";
+
+// Grid handed from the UI thread to the render thread
+static std::mutex grid_mutex;
+static std::atomic<bool> grid_pending{false};
+static std::vector<float> pending_vertices;
+static std::vector<GLuint> pending_indices;
+
+static std::atomic<bool> warp_enabled{false};
+static std::atomic<bool> grid_loaded{false};
+static std::atomic<int> grid_cols{0};
+static std::atomic<int> grid_rows{0};
+
+// Render thread only
+static bool initialized = false;
+static bool supported = false;
+static GLuint program = 0;
+static GLint frame_loc;
+static GLuint fbo = 0;
+static GLuint frame_texture = 0;
+static int frame_width = 0, frame_height = 0;
+static GLuint vbo = 0, ibo = 0;
+static int index_count = 0;
+
+static void init() {
+    initialized = true;
+    if (!GLEW_VERSION_3_0 && !GLEW_ARB_framebuffer_object) {
+        std::cerr << "Framebuffer objects unavailable, warp pass disabled\n";
+        return;
+    }
+    const char* attributes[] = { "a_vertex" };
+    program = CompileShaderProgram("warp", kWarpVertexShader, kWarpFragmentShader, attributes, 1);
+    if (!program) return;
+    frame_loc = glGetUniformLocation(program, "u_frame");
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &frame_texture);
+    glGenBuffers(1, &vbo);
+    glGenBuffers(1, &ibo);
+    supported = true;
+}
+
+static bool resize_frame(int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, frame_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame_texture, 0);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Warp framebuffer incomplete (0x" << std::hex << status << std::dec << "), warp pass disabled\n";
+        supported = false;
+        return false;
+    }
+    frame_width = width;
+    frame_height = height;
+    return true;
+}
+
+static void upload_pending_grid() {
+    std::lock_guard<std::mutex> lock(grid_mutex);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, pending_vertices.size() * sizeof(float), pending_vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, pending_indices.size() * sizeof(GLuint), pending_indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    index_count = (int)pending_indices.size();
+    grid_pending = false;
+}
+
+static std::string hostname() {
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+    return host;
+}
+
+static bool write_identity_grid(const std::string& path, int cols, int rows) {
+    if (mkdir(kWarpDir, 0755) != 0 && errno != EEXIST) {
+        std::perror("failed to create warp directory");
+    }
+    json j;
+    j["cols"] = cols;
+    j["rows"] = rows;
+    j["points"] = json::array();
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            j["points"].push_back({ (float)c / (cols - 1), (float)r / (rows - 1) });
+        }
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::perror("failed to write warp grid");
+        return false;
+    }
+    out << j.dump() << "\n";
+    return true;
+}
+}
+
+bool BeginWarpPass(int width, int height) {
+    if (!warp_enabled || !grid_loaded || width <= 0 || height <= 0) return false;
+    if (!initialized) init();
+    if (!supported) return false;
+    if (grid_pending) upload_pending_grid();
+    if ((width != frame_width || height != frame_height) && !resize_frame(width, height)) return false;
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    return true;
+}
+
+void EndWarpPass(int width, int height) {
+    PROFILE_ZONE("EndWarpPass");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_BLEND);
+
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, frame_texture);
+    glUniform1i(frame_loc, 0);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, (void*)0);
+    glDisableVertexAttribArray(0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glEnable(GL_BLEND);
+}
+
+bool LoadWarpGrid(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "failed to open warp grid " << path << "\n";
+        return false;
+    }
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    int cols, rows;
+    try {
+        json j;
+        in >> j;
+        cols = j.at("cols").get<int>();
+        rows = j.at("rows").get<int>();
+        const json& points = j.at("points");
+        if (cols < 2 || rows < 2 || cols > kMaxGridSize || rows > kMaxGridSize || (int)points.size() != cols * rows) {
+            std::cerr << "warp grid " << path << ": expected cols x rows points, 2 to " << kMaxGridSize << " each way\n";
+            return false;
+        }
+        vertices.reserve(4 * cols * rows);
+        for (int r = 0; r < rows; ++r) {
+            for (int c = 0; c < cols; ++c) {
+                const json& p = points.at(r * cols + c);
+                vertices.push_back(p.at(0).get<float>());
+                vertices.push_back(p.at(1).get<float>());
+                vertices.push_back((float)c / (cols - 1));
+                vertices.push_back((float)r / (rows - 1));
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing warp grid " << path << ": " << e.what() << "\n";
+        return false;
+    }
+
+    // two triangles per cell
+    indices.reserve(6 * (cols - 1) * (rows - 1));
+    for (int r = 0; r + 1 < rows; ++r) {
+        for (int c = 0; c + 1 < cols; ++c) {
+            GLuint i = r * cols + c;
+            GLuint cell[6] = { i, i + 1, i + cols, i + 1, i + cols + 1, i + cols };
+            indices.insert(indices.end(), cell, cell + 6);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(grid_mutex);
+        pending_vertices.swap(vertices);
+        pending_indices.swap(indices);
+        grid_pending = true;
+    }
+    grid_cols = cols;
+    grid_rows = rows;
+    grid_loaded = true;
+    return true;
+}
+
+std::string DefaultWarpGridPath() {
+    return std::string(kWarpDir) + "/" + hostname() + ".json";
+}
+
+void SetWarpEnabled(bool enabled) {
+    warp_enabled = enabled;
+}
+
+void RenderWarpControls() {
+    PROFILE_ZONE("RenderWarpControls");
+    static char path[256] = "";
+    static std::string status;
+    if (path[0] == '\0') std::snprintf(path, sizeof(path), "%s", DefaultWarpGridPath().c_str());
+
+    ImGui::Begin("Warp");
+    bool enabled = warp_enabled;
+    if (ImGui::Checkbox("Enable Warp Pass", &enabled)) warp_enabled = enabled;
+    ImGui::InputText("Grid File", path, sizeof(path));
+    if (ImGui::Button("Load Grid")) {
+        status = LoadWarpGrid(path) ? "Loaded" : "Failed to load, see console";
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Write Identity Grid")) {
+        status = write_identity_grid(path, 32, 32) && LoadWarpGrid(path) ? "Wrote 32x32 identity grid" : "Failed to write grid";
+    }
+    if (grid_loaded) {
+        ImGui::Text("Grid: %d x %d control points", grid_cols.load(), grid_rows.load());
+    } else {
+        ImGui::Text("No grid loaded");
+    }
+    if (!status.empty()) ImGui::Text("%s", status.c_str());
+    ImGui::End();
+}
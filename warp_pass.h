@@ -0,0 +1,26 @@
+#pragma once
+#include <string>
+
+// Optional final pass that corrects projector lens and floor distortion.
+// The stimulus is rendered into an offscreen texture, which is then drawn
+// through a grid of control points in a single draw call, so the cost does
+// not depend on what was drawn.
+//
+// A warp grid file is JSON, the control points in row-major order:
+//   { "cols": 32, "rows": 32, "points": [[x, y], ...] }
+// Point (c, r) is where grid position (c / (cols - 1), r / (rows - 1)) of
+// the undistorted frame should land. Both are window fractions, y down, so
+// an identity grid leaves the frame unchanged.
+
+// Render thread, with the spotlight context current. BeginWarpPass returns
+// false and changes nothing when warping is off or unavailable; otherwise
+// drawing goes to the offscreen frame until EndWarpPass.
+bool BeginWarpPass(int width, int height);
+void EndWarpPass(int width, int height);
+
+// UI thread. Parses the file and hands the grid to the render thread.
+bool LoadWarpGrid(const std::string& path);
+std::string DefaultWarpGridPath();  // per rig, like the calibration file
+void SetWarpEnabled(bool enabled);
+
+void RenderWarpControls();